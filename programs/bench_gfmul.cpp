@@ -0,0 +1,110 @@
+#include <emp-tool/emp-tool.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+using namespace std;
+using namespace emp;
+
+// Microbenchmark for the GF(2^128) inner product of the IKNP/KOS check
+// (2048 products per chunk), checked against a bitwise reference.
+
+const int n = 2048;
+const int iters = 2000;
+
+#if defined(__PCLMUL__)
+const char * backend = "pclmul";
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+const char * backend = "pmull";
+#else
+const char * backend = "portable";
+#endif
+
+bool get_bit(const block & a, int i) {
+    return ((i < 64 ? a.low : a.high) >> (i % 64)) & 1;
+}
+
+void flip_bit(block & a, int i) {
+    (i < 64 ? a.low : a.high) ^= 1ULL << (i % 64);
+}
+
+// Shift-and-add, reducing modulo x^128 + x^7 + x^2 + x + 1 one bit at a time
+block ref_gfmul(block a, const block & b) {
+    block res = zero_block;
+    for (int i = 0; i < 128; ++i) {
+        if (get_bit(b, i))
+            res ^= a;
+        bool carry = get_bit(a, 127);
+        a = block((a.high << 1) | (a.low >> 63), a.low << 1);
+        if (carry)
+            a.low ^= 0x87;
+    }
+    return res;
+}
+
+block reflect(const block & a) {
+    block res = zero_block;
+    for (int i = 0; i < 128; ++i)
+        if (get_bit(a, i))
+            flip_bit(res, 127 - i);
+    return res;
+}
+
+void check(const vector<block>& a, const vector<block>& b) {
+    block sum = zero_block;
+    for (int i = 0; i < n; ++i) {
+        block expected = ref_gfmul(a[i], b[i]), res;
+        sum ^= expected;
+
+        gfmul(a[i], b[i], &res);
+        if (!cmpBlock(&res, &expected, 1)) {
+            cout << "gfmul\tMISMATCH" << endl;
+            exit(1);
+        }
+
+        gfmul_reflect(reflect(a[i]), reflect(b[i]), &res);
+        res = reflect(res);
+        if (!cmpBlock(&res, &expected, 1)) {
+            cout << "gfmul_reflect\tMISMATCH" << endl;
+            exit(1);
+        }
+    }
+
+    block res;
+    vector_inn_prdt_sum_red(&res, a.data(), b.data(), n);
+    if (!cmpBlock(&res, &sum, 1)) {
+        cout << "vector_inn_prdt_sum_red\tMISMATCH" << endl;
+        exit(1);
+    }
+}
+
+template<typename F>
+void bench(const char * name, F f, vector<block>& a, const vector<block>& b, int rounds) {
+    block res[2];
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        f(res, a.data(), b.data());
+        a[i % n] ^= res[0];
+    }
+    double ns = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count() / ((double)rounds * n);
+    cout << name << "\t" << ns << " ns/product" << endl;
+}
+
+int main() {
+    vector<block> a(n), b(n);
+    PRG prg(&zero_block);
+    prg.random_block(a.data(), n);
+    prg.random_block(b.data(), n);
+
+    check(a, b);
+    cout << "gfmul matches the bitwise reference, clmul64 backend: " << backend << endl;
+
+    bench("reference", [](block * res, const block * x, const block * y) {
+        res[0] = zero_block;
+        for (int i = 0; i < n; ++i)
+            res[0] ^= ref_gfmul(x[i], y[i]);
+    }, a, b, iters / 100);
+    bench("inn_prdt", [](block * res, const block * x, const block * y) {
+        vector_inn_prdt_sum_no_red(res, x, y, n);
+    }, a, b, iters);
+    return 0;
+}
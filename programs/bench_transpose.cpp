@@ -0,0 +1,48 @@
+#include <emp-tool/emp-tool.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+using namespace std;
+using namespace emp;
+
+// Microbenchmark for the IKNP bit-matrix transpose (128 x 2048 per chunk).
+
+const uint64_t nrows = 128;
+const uint64_t ncols = 2048;
+const int iters = 20000;
+
+template<typename F>
+void bench(const char * name, F f, const vector<uint8_t>& expected) {
+    vector<uint8_t> inp(nrows*ncols/8), out(nrows*ncols/8);
+    PRG prg(&zero_block);
+    prg.random_data(inp.data(), inp.size());
+
+    f(out.data(), inp.data());
+    if (out != expected) {
+        cout << name << "\tMISMATCH" << endl;
+        exit(1);
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < iters; ++i) {
+        f(out.data(), inp.data());
+        inp[i % inp.size()] ^= out[(i * 7) % out.size()];
+    }
+    double ns = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count() / iters;
+    cout << name << "\t" << ns << " ns/matrix\t" << (nrows*ncols) / ns << " Gbit/s" << endl;
+}
+
+int main() {
+    vector<uint8_t> inp(nrows*ncols/8), expected(nrows*ncols/8);
+    PRG prg(&zero_block);
+    prg.random_data(inp.data(), inp.size());
+    sse_trans_scalar(expected.data(), inp.data(), nrows, ncols);
+
+    bench("scalar", [](uint8_t * o, const uint8_t * i) { sse_trans_scalar(o, i, nrows, ncols); }, expected);
+    bench("eklundh", [](uint8_t * o, const uint8_t * i) { sse_trans_eklundh(o, i, nrows, ncols); }, expected);
+#ifdef EMP_TRANS_SIMD
+    bench("simd", [](uint8_t * o, const uint8_t * i) { sse_trans_simd(o, i, nrows, ncols); }, expected);
+#endif
+    bench("sse_trans", [](uint8_t * o, const uint8_t * i) { sse_trans(o, i, nrows, ncols); }, expected);
+    return 0;
+}
@@ -1,44 +1,290 @@
 #include <emscripten.h>
+#include <algorithm>
 #include <cstdio>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <new>
+#include <vector>
+
+#ifdef EMP_SHARED_RINGS
+#include <atomic>
+#endif
 
 #include "emp-tool/io/i_raw_io.h"
 #include "emp-ag2pc/2pc.h"
 #include "emp-agmpc/mpc.h"
+#include "emp-sh2pc/sh2pc.h"
 
 void run_2pc_impl(int party, int nP);
-void run_mpc_impl(int party, int nP);
+template <typename Session> void run_mpc_impl(int party, int nP);
+void run_sh2pc_impl(int party, int nP);
+
+// Pointers and sizes arrive as BigInt in the memory64 build, so the JS side
+// wraps them in Number() before indexing HEAPU8.
+
+#ifdef EMP_SHARED_RINGS
+// Byte ring in shared wasm memory between the worker and the main thread,
+// with one producer and one consumer. head and tail count bytes since the
+// start and wrap at 2^32, the capacity is a power of two. RingBridge.ts
+// mirrors this layout.
+struct SharedRing {
+    std::atomic<uint32_t> head;   // moved by the producer
+    std::atomic<uint32_t> tail;   // moved by the consumer
+    std::atomic<uint32_t> want;   // bytes the worker waits for, inbound only
+    std::atomic<uint32_t> failed; // set by the main thread when its io fails
+    uint32_t capacity;
+    uint32_t reserved[3];
+
+    char* data() {
+        return reinterpret_cast<char*>(this + 1);
+    }
+
+    void write(uint32_t pos, const char* src, uint32_t len) {
+        uint32_t at = pos & (capacity - 1);
+        uint32_t first = std::min(len, capacity - at);
+        memcpy(data() + at, src, first);
+        memcpy(data(), src + first, len - first);
+    }
+
+    void read(uint32_t pos, char* dst, uint32_t len) {
+        uint32_t at = pos & (capacity - 1);
+        uint32_t first = std::min(len, capacity - at);
+        memcpy(dst, data() + at, first);
+        memcpy(dst + first, data(), len - first);
+    }
+
+    static SharedRing* create(uint32_t capacity) {
+        void* mem = aligned_alloc(alignof(SharedRing), sizeof(SharedRing) + capacity);
+
+        if (mem == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        SharedRing* ring = new (mem) SharedRing{};
+        ring->capacity = capacity;
+        return ring;
+    }
+
+    static void destroy(SharedRing* ring) {
+        ring->~SharedRing();
+        free(ring);
+    }
+
+    // Blocks the worker until word no longer holds seen. The main thread
+    // calls Atomics.notify after changing it.
+    static void wait(std::atomic<uint32_t>& word, uint32_t seen) {
+        __builtin_wasm_memory_atomic_wait32(reinterpret_cast<int*>(&word), (int)seen, -1);
+    }
+};
+
+static_assert(sizeof(SharedRing) == 32, "RingBridge.ts expects a 32 byte header");
+
+EM_JS(void, ring_open_js, (int other_party, char channel_label, void* out_ring, void* in_ring), {
+    if (!Module.emp?.rings) {
+        throw new Error("Module.emp.rings is not defined in JavaScript.");
+    }
+
+    Module.emp.rings.open(
+        other_party - 1,
+        String.fromCharCode(channel_label),
+        Number(out_ring),
+        Number(in_ring),
+        wasmMemory.buffer,
+    );
+});
+
+// Tells the main thread that an outbound ring has data or an inbound ring
+// has a want.
+EM_JS(void, ring_doorbell_js, (void* ring), {
+    Module.emp.rings.doorbell(Number(ring));
+});
+
+// Channel over two SharedRings, for the builds with shared memory that run
+// in a browser worker. Sends go straight into the outbound ring and are
+// published on flush, when the ring fills, or before any channel waits in
+// recv, like RawIOJS. Receives block on Atomics.wait until the main thread
+// has filled the inbound ring, which it does with everything that has
+// arrived, up to the free space.
+class RingIOJS : public IRawIO {
+public:
+    static constexpr uint32_t ring_capacity = 1 << 18;
+
+    int other_party;
+    char channel_label;
+
+    RingIOJS(
+        int other_party,
+        char channel_label
+    ):
+        other_party(other_party),
+        channel_label(channel_label)
+    {
+        out = SharedRing::create(ring_capacity);
+        in = SharedRing::create(ring_capacity);
+        instances().push_back(this);
+        ring_open_js(other_party, channel_label, out, in);
+    }
+
+    ~RingIOJS() override {
+        flush();
+
+        // The main thread may still be copying out the last flush
+        uint32_t tail;
+        while ((tail = out->tail.load()) != out_head) {
+            SharedRing::wait(out->tail, tail);
+        }
 
+        auto& all = instances();
+        all.erase(std::find(all.begin(), all.end(), this));
+
+        SharedRing::destroy(out);
+        SharedRing::destroy(in);
+    }
+
+    void send(const void* data, size_t len) override {
+        const char* bytes = static_cast<const char*>(data);
+
+        while (len > 0) {
+            uint32_t tail = out->tail.load(std::memory_order_acquire);
+            uint32_t space = out->capacity - (out_head - tail);
+
+            if (space == 0) {
+                flush();
+                SharedRing::wait(out->tail, tail);
+                continue;
+            }
+
+            uint32_t n = std::min<size_t>(space, len);
+            out->write(out_head, bytes, n);
+            out_head += n;
+            bytes += n;
+            len -= n;
+        }
+    }
+
+    void recv(void* data, size_t len) override {
+        char* dst = static_cast<char*>(data);
+
+        while (len > 0) {
+            uint32_t tail = in->tail.load(std::memory_order_relaxed);
+            uint32_t head = in->head.load(std::memory_order_acquire);
+
+            if (head == tail) {
+                flush_all();
+
+                uint32_t want = std::min<size_t>(len, in->capacity);
+                in->want.store(want);
+                ring_doorbell_js(in);
+
+                // The main thread clears want once it has written
+                while (in->want.load() == want) {
+                    SharedRing::wait(in->want, want);
+                }
+
+                if (in->failed.load()) {
+                    throw std::runtime_error("io recv failed");
+                }
+
+                continue;
+            }
+
+            uint32_t n = std::min<size_t>(head - tail, len);
+            in->read(tail, dst, n);
+            in->tail.store(tail + n, std::memory_order_release);
+            dst += n;
+            len -= n;
+        }
+    }
+
+    void flush() override {
+        if (out->head.load(std::memory_order_relaxed) == out_head) {
+            return;
+        }
+
+        out->head.store(out_head, std::memory_order_release);
+        ring_doorbell_js(out);
+    }
+
+    static void flush_all() {
+        for (RingIOJS* io : instances()) {
+            io->flush();
+        }
+    }
+
+    static size_t open_channels() {
+        return instances().size();
+    }
+
+private:
+    SharedRing* out;
+    SharedRing* in;
+    uint32_t out_head = 0;
+
+    // Every channel of the module, the engines only do IO on the thread that
+    // runs the protocol.
+    static std::vector<RingIOJS*>& instances() {
+        static std::vector<RingIOJS*> all;
+        return all;
+    }
+};
+
+using ChannelIOJS = RingIOJS;
+#else
 // Implement send_js function to send data from C++ to JavaScript
 EM_JS(void, send_js, (int to_party, char channel_label, const void* data, size_t len), {
     if (!Module.emp?.io?.send) {
         throw new Error("Module.emp.io.send is not defined in JavaScript.");
     }
 
-    // Copy data from WebAssembly memory to a JavaScript Uint8Array
-    const dataArray = HEAPU8.slice(data, data + len);
+    // Copy data from WebAssembly memory to a JavaScript Uint8Array. The copy
+    // owns its ArrayBuffer, so the worker can transfer it to the main thread.
+    const dataArray = HEAPU8.slice(Number(data), Number(data) + Number(len));
 
     Module.emp.io.send(to_party - 1, String.fromCharCode(channel_label), dataArray);
 });
 
-// Implement recv_js function to receive data from JavaScript to C++
-EM_ASYNC_JS(void, recv_js, (int from_party, char channel_label, void* data, size_t len), {
-    if (!Module.emp?.io?.recv) {
-        reject(new Error("Module.emp.io.recv is not defined in JavaScript."));
-        return;
+// Implement recv_js function to receive data from JavaScript to C++. It
+// waits for at least min_len bytes and writes up to max_len, taking whatever
+// has already arrived, and returns how many it wrote. RawIOJS only reads the
+// count when max_len fits its receive buffer.
+EM_ASYNC_JS(int, recv_js, (int from_party, char channel_label, void* data, size_t min_len, size_t max_len), {
+    const io = Module.emp?.io;
+
+    if (!io?.recv) {
+        throw new Error("Module.emp.io.recv is not defined in JavaScript.");
     }
 
-    // Wait for data from JavaScript
-    const dataArray = await Module.emp.io.recv(from_party - 1, String.fromCharCode(channel_label), len);
+    const channel = String.fromCharCode(channel_label);
+
+    // Wait for data from JavaScript, reading ahead if the io supports it
+    const dataArray = io.recvAvailable
+        ? await io.recvAvailable(from_party - 1, channel, Number(min_len), Number(max_len))
+        : await io.recv(from_party - 1, channel, Number(min_len));
+
+    if (dataArray.length < Number(min_len) || dataArray.length > Number(max_len)) {
+        throw new Error("io returned the wrong number of bytes.");
+    }
 
     // Copy data from JavaScript Uint8Array to WebAssembly memory
-    HEAPU8.set(dataArray, data);
+    HEAPU8.set(dataArray, Number(data));
+
+    return dataArray.length;
 });
 
+// Sends are collected and handed to JS in one piece on flush, when the
+// buffer fills, or before any channel waits in recv. The last rule keeps
+// the protocols from waiting on bytes that are still sitting here, even
+// where they don't flush before reading.
+//
+// Receives read ahead: each call into JS takes everything that has arrived
+// on the channel, up to the receive buffer, and later small recvs are served
+// from it.
 class RawIOJS : public IRawIO {
 public:
+    static constexpr size_t send_buffer_size = 1 << 16;
+    static constexpr size_t recv_buffer_size = 1 << 16;
+
     int other_party;
     char channel_label;
 
@@ -48,21 +294,105 @@ public:
     ):
         other_party(other_party),
         channel_label(channel_label)
-    {}
+    {
+        send_buffer.reserve(send_buffer_size);
+        recv_buffer.resize(recv_buffer_size);
+        instances().push_back(this);
+    }
+
+    ~RawIOJS() override {
+        flush();
+
+        auto& all = instances();
+        all.erase(std::find(all.begin(), all.end(), this));
+    }
 
     void send(const void* data, size_t len) override {
-        send_js(other_party, channel_label, data, len);
+        if (send_buffer.size() + len > send_buffer_size) {
+            flush();
+
+            if (len >= send_buffer_size) {
+                send_js(other_party, channel_label, data, len);
+                return;
+            }
+        }
+
+        const char* bytes = static_cast<const char*>(data);
+        send_buffer.insert(send_buffer.end(), bytes, bytes + len);
     }
 
     void recv(void* data, size_t len) override {
-        recv_js(other_party, channel_label, data, len);
+        char* out = static_cast<char*>(data);
+
+        size_t buffered = std::min(len, recv_end - recv_pos);
+        memcpy(out, recv_buffer.data() + recv_pos, buffered);
+        recv_pos += buffered;
+        out += buffered;
+        len -= buffered;
+
+        if (len == 0) {
+            return;
+        }
+
+        flush_all();
+
+        if (len >= recv_buffer_size) {
+            recv_js(other_party, channel_label, out, len, len);
+            return;
+        }
+
+        recv_pos = 0;
+        recv_end = recv_js(other_party, channel_label, recv_buffer.data(), len, recv_buffer_size);
+        memcpy(out, recv_buffer.data(), len);
+        recv_pos = len;
     }
 
     void flush() override {
-        // Ignored for now
+        if (send_buffer.empty()) {
+            return;
+        }
+
+        send_js(other_party, channel_label, send_buffer.data(), send_buffer.size());
+        send_buffer.clear();
+    }
+
+    static void flush_all() {
+        for (RawIOJS* io : instances()) {
+            io->flush();
+        }
+    }
+
+    static size_t open_channels() {
+        return instances().size();
+    }
+
+private:
+    std::vector<char> send_buffer;
+    std::vector<char> recv_buffer;
+    size_t recv_pos = 0;
+    size_t recv_end = 0;
+
+    // Every channel of the module, the engines only do IO on the thread that
+    // runs the protocol.
+    static std::vector<RawIOJS*>& instances() {
+        static std::vector<RawIOJS*> all;
+        return all;
     }
 };
 
+using ChannelIOJS = RawIOJS;
+#endif
+
+EM_JS(int, get_ot_k, (int other_party), {
+    const otK = Module.emp?.otK;
+
+    if (otK === undefined) {
+        return 1;
+    }
+
+    return typeof otK === 'number' ? otK : (otK[other_party - 1] ?? 1);
+});
+
 class MultiIOJS : public IMultiIO {
 public:
     int mParty;
@@ -73,8 +403,10 @@ public:
 
     MultiIOJS(int party, int nP) : mParty(party), nP(nP) {
         for (int i = 0; i <= nP; i++) {
-            a_channels.emplace_back(std::make_shared<RawIOJS>(i, 'a'));
-            b_channels.emplace_back(std::make_shared<RawIOJS>(i, 'b'));
+            // No channels to party 0 (unused) or to ourselves
+            bool peer = i != 0 && i != party;
+            a_channels.emplace_back(peer ? std::make_shared<ChannelIOJS>(i, 'a') : nullptr);
+            b_channels.emplace_back(peer ? std::make_shared<ChannelIOJS>(i, 'b') : nullptr);
         }
     }
 
@@ -108,72 +440,99 @@ public:
         else
             b_channels[idx].flush();
     }
+
+    int ot_k(int other_party) override {
+        return get_ot_k(other_party);
+    }
 };
 
-EM_JS(char*, get_circuit_raw, (int* lengthPtr), {
+EM_JS(int, get_circuit_length, (), {
     if (!Module.emp?.circuit) {
         throw new Error("Module.emp.circuit is not defined in JavaScript.");
     }
 
-    const circuitString = Module.emp.circuit; // Get the string from JavaScript
-    const length = lengthBytesUTF8(circuitString) + 1; // Calculate length including the null terminator
+    // Length including the null terminator
+    return lengthBytesUTF8(Module.emp.circuit) + 1;
+});
 
-    // Allocate memory for the string
-    const strPtr = Module._js_char_malloc(length);
-    stringToUTF8(circuitString, strPtr, length);
+EM_JS(void, get_circuit_raw, (char* circuit, int length), {
+    stringToUTF8(Module.emp.circuit, Number(circuit), length);
+});
 
-    // Set the length at the provided pointer location
-    setValue(lengthPtr, length, 'i32');
+EM_JS(int, get_circuit_id_length, (), {
+    const id = Module.emp?.circuitId;
+
+    // Length including the null terminator, or 0 for no id
+    return id ? lengthBytesUTF8(id) + 1 : 0;
+});
 
-    // Return the pointer
-    return strPtr;
+EM_JS(void, get_circuit_id_raw, (char* id, int length), {
+    stringToUTF8(Module.emp.circuitId, Number(id), length);
 });
 
-emp::BristolFormat get_circuit() {
-    int length = 0;
-    char* circuit_raw = get_circuit_raw(&length);
+std::shared_ptr<emp::BristolFormat> parse_circuit() {
+    // Allocated on the C++ side so JS never has to hand back a pointer, which
+    // would need to be a BigInt in the memory64 build.
+    std::vector<char> circuit_raw(get_circuit_length());
+    get_circuit_raw(circuit_raw.data(), circuit_raw.size());
 
-    emp::BristolFormat circuit;
-    circuit.from_str(circuit_raw);
-    free(circuit_raw);
+    auto circuit = std::make_shared<emp::BristolFormat>();
+    circuit->from_str(circuit_raw.data());
 
     return circuit;
 }
 
-EM_JS(uint8_t*, get_input_bits_raw, (int* lengthPtr), {
-    if (!Module.emp?.inputBits) {
-        throw new Error("Module.emp.inputBits is not defined in JavaScript.");
+// Circuits parsed by earlier sessions, by the digest loadCircuit gives them
+// (Module.emp.circuitId), least recently used first. A warm module running
+// the same circuit again skips copying it out of JS and parsing it.
+static std::vector<std::pair<std::string, std::shared_ptr<emp::BristolFormat>>> circuit_cache;
+static const size_t circuit_cache_size = 4;
+
+std::shared_ptr<emp::BristolFormat> get_circuit() {
+    size_t id_length = get_circuit_id_length();
+
+    if (id_length == 0) {
+        return parse_circuit();
     }
 
-    const inputBits = Module.emp.inputBits; // Assume this is a Uint8Array
+    std::vector<char> id_raw(id_length);
+    get_circuit_id_raw(id_raw.data(), id_raw.size());
+    std::string id(id_raw.data());
 
-    // Allocate memory for the inputBits array
-    const bytePtr = Module._js_malloc(inputBits.length);
-    Module.HEAPU8.set(inputBits, bytePtr);
+    for (auto it = circuit_cache.begin(); it != circuit_cache.end(); ++it) {
+        if (it->first == id) {
+            auto entry = std::move(*it);
+            circuit_cache.erase(it);
+            circuit_cache.push_back(std::move(entry));
+            return circuit_cache.back().second;
+        }
+    }
 
-    // Set the length at the provided pointer location
-    setValue(lengthPtr, inputBits.length, 'i32');
+    auto circuit = parse_circuit();
 
-    // Return the pointer
-    return bytePtr;
-});
+    if (circuit_cache.size() >= circuit_cache_size) {
+        circuit_cache.erase(circuit_cache.begin());
+    }
 
-std::vector<bool> get_input_bits() {
-    int length = 0;
-    uint8_t* input_bits_raw = get_input_bits_raw(&length);
+    circuit_cache.emplace_back(id, circuit);
 
-    std::vector<bool> input_bits(length);
+    return circuit;
+}
 
-    for (int i = 0; i < length; ++i) {
-        input_bits[i] = input_bits_raw[i];
+EM_JS(int, get_input_bits_length, (), {
+    if (!Module.emp?.inputBits) {
+        throw new Error("Module.emp.inputBits is not defined in JavaScript.");
     }
 
-    free(input_bits_raw);
+    return Module.emp.inputBits.length;
+});
 
-    return input_bits;
-}
+EM_JS(void, get_input_bits_raw, (uint8_t* inputBits), {
+    // Module.emp.inputBits is a Uint8Array of packed bits
+    Module.HEAPU8.set(Module.emp.inputBits, Number(inputBits));
+});
 
-EM_JS(size_t, get_input_bits_per_party, (int i), {
+EM_JS(int, get_input_bits_per_party, (int i), {
     if (!Module.emp?.inputBitsPerParty) {
         throw new Error("Module.emp.inputBitsPerParty is not defined in JavaScript.");
     }
@@ -191,13 +550,28 @@ EM_JS(size_t, get_input_bits_per_party, (int i), {
     return res;
 });
 
+// Module.emp.inputBits holds this party's inputBitsPerParty bits packed 8 to
+// a byte (see emp::PackedBits), so it's that many bits rounded up to bytes.
+std::vector<uint8_t> get_input_bits(int party) {
+    size_t bit_count = get_input_bits_per_party(party - 1);
+    std::vector<uint8_t> input_bits_raw(get_input_bits_length());
+
+    if (input_bits_raw.size() != emp::PackedBits::bytes_for(bit_count)) {
+        throw std::runtime_error("Mismatch between inputBits and inputBitsPerParty");
+    }
+
+    get_input_bits_raw(input_bits_raw.data());
+
+    return input_bits_raw;
+}
+
 EM_JS(void, handle_output_bits_raw, (uint8_t* outputBits, int length), {
     if (!Module.emp?.handleOutput) {
         throw new Error("Module.emp.handleOutput is not defined in JavaScript.");
     }
 
     // Copy the output bits to a Uint8Array
-    const outputBitsArray = new Uint8Array(Module.HEAPU8.buffer, outputBits, length);
+    const outputBitsArray = new Uint8Array(Module.HEAPU8.buffer, Number(outputBits), length);
 
     // Call the JavaScript function with the output bits
     Module.emp.handleOutput(outputBitsArray.slice());
@@ -208,137 +582,448 @@ EM_JS(void, handle_error, (const char* message), {
         throw new Error("Module.emp.handleError is not defined in JavaScript.");
     }
 
-    Module.emp.handleError(new Error(UTF8ToString(message)));
+    Module.emp.handleError(new Error(UTF8ToString(Number(message))));
 });
 
-void handle_output_bits(const std::vector<bool>& output_bits) {
-    uint8_t* output_bits_raw = new uint8_t[output_bits.size()];
+// Output bits are packed like the inputs
+void handle_output_bits(const std::vector<uint8_t>& output_bits) {
+    handle_output_bits_raw(const_cast<uint8_t*>(output_bits.data()), output_bits.size());
+}
 
-    for (size_t i = 0; i < output_bits.size(); ++i) {
-        output_bits_raw[i] = output_bits[i];
+EM_JS(void, handle_prepared, (), {
+    if (!Module.emp?.handlePrepared) {
+        throw new Error("Module.emp.handlePrepared is not defined in JavaScript.");
     }
 
-    handle_output_bits_raw(output_bits_raw, output_bits.size());
+    Module.emp.handlePrepared();
+});
 
-    delete[] output_bits_raw;
-}
+void check_2pc_parties(int party, int nP) {
+    if (nP != 2) {
+        throw std::runtime_error("2PC only supports 2 parties");
+    }
 
-extern "C" {
-    EMSCRIPTEN_KEEPALIVE
-    void run_2pc(int party, int size) {
-        run_2pc_impl(party + 1, size);
+    if (party != 1 && party != 2) {
+        throw std::runtime_error("Invalid party number");
     }
+}
 
-    EMSCRIPTEN_KEEPALIVE
-    void run_mpc(int party, int size) {
-        run_mpc_impl(party + 1, size);
+void check_2pc_input_bits_per_party(const emp::BristolFormat& circuit) {
+    for (int p = 0; p < 2; p++) {
+        size_t input_count = get_input_bits_per_party(p);
+        size_t circuit_input_count = (p == 0) ? circuit.n1 : circuit.n2;
+
+        if (input_count != circuit_input_count) {
+            throw std::runtime_error("Mismatch between circuit and inputBitsPerParty");
+        }
     }
+}
 
-    EMSCRIPTEN_KEEPALIVE
-    uint8_t* js_malloc(int size) {
-        return (uint8_t*)malloc(size);
+// CMPC only needs the total to match, the split between parties is up to
+// inputBitsPerParty
+void check_mpc_input_bits_per_party(const emp::BristolFormat& circuit, int nP) {
+    size_t input_count = 0;
+
+    for (int p = 0; p < nP; p++) {
+        input_count += get_input_bits_per_party(p);
     }
 
-    EMSCRIPTEN_KEEPALIVE
-    char* js_char_malloc(int size) {
-        return (char*)malloc(size);
+    if (input_count != size_t(circuit.n1 + circuit.n2)) {
+        throw std::runtime_error("Mismatch between circuit and inputBitsPerParty");
     }
 }
 
-void run_2pc_impl(int party, int nP) {
-    if (nP != 2) {
-        throw std::runtime_error("2PC only supports 2 parties");
-    }
+// A computation that has run everything that doesn't depend on the inputs,
+// kept between prepare_2pc/prepare_mpc and run_online so those phases can run
+// before the inputs are known.
+class PreparedSession {
+public:
+    explicit PreparedSession(int party): party(party) {}
+    virtual ~PreparedSession() = default;
 
-    if (party != 1 && party != 2) {
-        throw std::runtime_error("Invalid party number");
+    const int party;
+
+    // Takes and returns packed bits, as get_input_bits and handle_output_bits
+    virtual std::vector<uint8_t> online(const std::vector<uint8_t>& input_bits) = 0;
+};
+
+class Prepared2PC : public PreparedSession {
+public:
+    Prepared2PC(int party, int nP):
+        PreparedSession(party),
+        io(std::make_shared<ChannelIOJS>(party == 1 ? 2 : 1, 'a')),
+        circuit(get_circuit())
+    {
+        check_2pc_input_bits_per_party(*circuit);
+
+        // Unlike run_2pc, the garbled tables have to be kept until the
+        // inputs arrive, so the circuit isn't streamed.
+        twopc = std::make_unique<emp::C2PC>(io, party, circuit.get());
+        twopc->function_independent();
+        twopc->function_dependent();
     }
 
-    try {
-        int other_party = (party == 1) ? 2 : 1;
+    std::vector<uint8_t> online(const std::vector<uint8_t>& input_bits) override {
+        std::vector<uint8_t> output_bits(emp::PackedBits::bytes_for(circuit->n3));
 
-        auto io = emp::IOChannel(std::make_shared<RawIOJS>(other_party, 'a'));
-        auto circuit = get_circuit();
-        std::vector<bool> input_bits = get_input_bits();
+        twopc->online(
+            emp::PackedBitsView(input_bits.data(), get_input_bits_per_party(party - 1)),
+            emp::PackedBits(output_bits.data(), circuit->n3),
+            true
+        );
 
-        {
-            size_t circuit_input_count = (party == 1) ? circuit.n1 : circuit.n2;
+        return output_bits;
+    }
 
-            if (input_bits.size() != circuit_input_count) {
-                throw std::runtime_error("Mismatch between circuit and inputBits");
-            }
-        }
+private:
+    emp::IOChannel io;
+    std::shared_ptr<emp::BristolFormat> circuit;
+    std::unique_ptr<emp::C2PC> twopc;
+};
 
-        for (int p = 0; p < 2; p++) {
+class PreparedMPC : public PreparedSession {
+public:
+    PreparedMPC(int party, int nP, bool semi_honest = false):
+        PreparedSession(party),
+        nP(nP),
+        io(std::make_shared<MultiIOJS>(party, nP)),
+        circuit(get_circuit())
+    {
+        check_mpc_input_bits_per_party(*circuit, nP);
+
+        mpc = std::make_unique<CMPC>(io, circuit.get(), nullptr, 40, semi_honest);
+        mpc->function_independent();
+        mpc->function_dependent();
+    }
+
+    std::vector<uint8_t> online(const std::vector<uint8_t>& input_bits) override {
+        FlexIn input(nP, circuit->n1 + circuit->n2, party);
+
+        int bit_pos = 0;
+        for (int p = 0; p < nP; p++) {
             size_t input_count = get_input_bits_per_party(p);
-            size_t circuit_input_count = (p == 0) ? circuit.n1 : circuit.n2;
+            input.assign_party(bit_pos, input_count, p + 1);
 
-            if (input_count != circuit_input_count) {
-                throw std::runtime_error("Mismatch between circuit and inputBitsPerParty");
+            if (p + 1 == party) {
+                input.assign_plaintext_bits(
+                    bit_pos,
+                    emp::PackedBitsView(input_bits.data(), input_count)
+                );
             }
+
+            bit_pos += input_count;
         }
 
-        auto twopc = emp::C2PC(io, party, &circuit);
+        assert(bit_pos == circuit->n1 + circuit->n2);
 
-        twopc.function_independent();
-        twopc.function_dependent();
+        FlexOut output(nP, circuit->n3, party);
 
-        std::vector<bool> output_bits = twopc.online(input_bits, true);
-        handle_output_bits(output_bits);
+        // All parties receive the output.
+        output.assign_party(0, circuit->n3, 0);
+
+        mpc->online(&input, &output);
+
+        std::vector<uint8_t> output_bits(emp::PackedBits::bytes_for(circuit->n3));
+        output.get_plaintext_bits(0, emp::PackedBits(output_bits.data(), circuit->n3));
+
+        return output_bits;
+    }
+
+private:
+    int nP;
+    std::shared_ptr<IMultiIO> io;
+    std::shared_ptr<emp::BristolFormat> circuit;
+    std::unique_ptr<CMPC> mpc;
+};
+
+// Semi-honest CMPC, for more than 2 parties that trust each other to follow
+// the protocol. One AND triple per gate without bucketing, and no MAC checks.
+class PreparedSHMPC : public PreparedMPC {
+public:
+    PreparedSHMPC(int party, int nP): PreparedMPC(party, nP, true) {}
+};
+
+// Semi-honest 2PC, for parties that trust each other to follow the protocol.
+// Only the base OTs and garbling keys come before the inputs, the garbled
+// circuit streams through online either way.
+class PreparedSH2PC : public PreparedSession {
+public:
+    PreparedSH2PC(int party, int nP):
+        PreparedSession(party),
+        io(std::make_shared<ChannelIOJS>(party == 1 ? 2 : 1, 'a')),
+        circuit(get_circuit())
+    {
+        check_2pc_input_bits_per_party(*circuit);
+
+        twopc = std::make_unique<emp::SH2PC>(io, party, circuit.get());
+        twopc->function_independent();
+    }
+
+    std::vector<uint8_t> online(const std::vector<uint8_t>& input_bits) override {
+        std::vector<uint8_t> output_bits(emp::PackedBits::bytes_for(circuit->n3));
+
+        twopc->online(
+            emp::PackedBitsView(input_bits.data(), get_input_bits_per_party(party - 1)),
+            emp::PackedBits(output_bits.data(), circuit->n3),
+            true
+        );
+
+        return output_bits;
+    }
+
+private:
+    emp::IOChannel io;
+    std::shared_ptr<emp::BristolFormat> circuit;
+    std::unique_ptr<emp::SH2PC> twopc;
+};
+
+// A module can run any number of sessions one after another, so callers can
+// keep it warm instead of instantiating the wasm for every computation.
+static bool session_running = false;
+
+// Set between a successful prepare_2pc/prepare_mpc and run_online
+static std::unique_ptr<PreparedSession> prepared_session;
+
+#if EMP_THREADS > 1
+// Held between sessions, so later sessions reuse the engines' threads
+// instead of joining and restarting them, until release_threads
+static std::shared_ptr<emp::ThreadPool> session_pool;
+#endif
+
+bool begin_session() {
+    if (session_running) {
+        handle_error("A session is already running in this module");
+        return false;
+    }
+
+    if (prepared_session) {
+        handle_error("A prepared session is waiting for run_online");
+        return false;
+    }
+
+#if EMP_THREADS > 1
+    if (!session_pool)
+        session_pool = emp::shared_thread_pool(EMP_THREADS);
+#endif
+
+    session_running = true;
+    return true;
+}
+
+template <typename Session>
+void prepare_impl(int party, int nP) {
+    try {
+        prepared_session = std::make_unique<Session>(party, nP);
+        ChannelIOJS::flush_all();
+        handle_prepared();
     } catch (const std::exception& e) {
+        prepared_session.reset();
         handle_error(e.what());
     }
 }
 
-void run_mpc_impl(int party, int nP) {
+void run_online_impl() {
+    std::unique_ptr<PreparedSession> session = std::move(prepared_session);
+
     try {
-        std::shared_ptr<IMultiIO> io = std::make_shared<MultiIOJS>(party, nP);
-        auto circuit = get_circuit();
-        auto mpc = CMPC(io, &circuit);
+        std::vector<uint8_t> output_bits = session->online(get_input_bits(session->party));
+        ChannelIOJS::flush_all();
+        session.reset();
+        handle_output_bits(output_bits);
+    } catch (const std::exception& e) {
+        session.reset();
+        handle_error(e.what());
+    }
+}
 
-        mpc.function_independent();
-        mpc.function_dependent();
+extern "C" {
+    EMSCRIPTEN_KEEPALIVE
+    void run_2pc(int party, int size) {
+        if (begin_session()) {
+            run_2pc_impl(party + 1, size);
+            session_running = false;
+        }
+    }
 
-        std::vector<bool> input_bits = get_input_bits();
+    EMSCRIPTEN_KEEPALIVE
+    void run_mpc(int party, int size) {
+        if (begin_session()) {
+            run_mpc_impl<PreparedMPC>(party + 1, size);
+            session_running = false;
+        }
+    }
 
-        FlexIn input(nP, circuit.n1 + circuit.n2, party);
+    // mode 'semi-honest', see PreparedSH2PC
+    EMSCRIPTEN_KEEPALIVE
+    void run_sh2pc(int party, int size) {
+        if (begin_session()) {
+            run_sh2pc_impl(party + 1, size);
+            session_running = false;
+        }
+    }
 
-        int bit_pos = 0;
-        for (int p = 0; p < nP; p++) {
-            size_t input_count = get_input_bits_per_party(p);
+    // mode 'semi-honest' with more than 2 parties, see PreparedSHMPC
+    EMSCRIPTEN_KEEPALIVE
+    void run_shmpc(int party, int size) {
+        if (begin_session()) {
+            run_mpc_impl<PreparedSHMPC>(party + 1, size);
+            session_running = false;
+        }
+    }
 
-            if (p + 1 == party) {
-                assert(input_count == input_bits.size());
+    // Runs the input-independent phases with Module.emp.circuit and
+    // Module.emp.inputBitsPerParty, then calls Module.emp.handlePrepared.
+    // run_online finishes the computation with Module.emp.inputBits.
+    EMSCRIPTEN_KEEPALIVE
+    void prepare_2pc(int party, int size) {
+        if (begin_session()) {
+            try {
+                check_2pc_parties(party + 1, size);
+                prepare_impl<Prepared2PC>(party + 1, size);
+            } catch (const std::exception& e) {
+                handle_error(e.what());
             }
 
-            for (size_t i = 0; i < input_count; i++) {
-                input.assign_party(bit_pos, p + 1);
-
-                if (p + 1 == party) {
-                    input.assign_plaintext_bit(bit_pos, input_bits[i]);
-                }
+            session_running = false;
+        }
+    }
 
-                bit_pos++;
+    EMSCRIPTEN_KEEPALIVE
+    void prepare_sh2pc(int party, int size) {
+        if (begin_session()) {
+            try {
+                check_2pc_parties(party + 1, size);
+                prepare_impl<PreparedSH2PC>(party + 1, size);
+            } catch (const std::exception& e) {
+                handle_error(e.what());
             }
-        }
 
-        assert(bit_pos == circuit.n1 + circuit.n2);
+            session_running = false;
+        }
+    }
 
-        FlexOut output(nP, circuit.n3, party);
+    EMSCRIPTEN_KEEPALIVE
+    void prepare_mpc(int party, int size) {
+        if (begin_session()) {
+            prepare_impl<PreparedMPC>(party + 1, size);
+            session_running = false;
+        }
+    }
 
-        for (int i = 0; i < circuit.n3; i++) {
-            // All parties receive the output.
-            output.assign_party(i, 0);
+    EMSCRIPTEN_KEEPALIVE
+    void prepare_shmpc(int party, int size) {
+        if (begin_session()) {
+            prepare_impl<PreparedSHMPC>(party + 1, size);
+            session_running = false;
         }
+    }
 
-        mpc.online(&input, &output);
+    // Parses Module.emp.circuit into the circuit cache under
+    // Module.emp.circuitId ahead of the sessions that run it (loadCircuit),
+    // calling Module.emp.handleError if that fails.
+    EMSCRIPTEN_KEEPALIVE
+    void load_circuit() {
+        try {
+            get_circuit();
+        } catch (const std::exception& e) {
+            handle_error(e.what());
+        }
+    }
 
-        std::vector<bool> output_bits;
+    EMSCRIPTEN_KEEPALIVE
+    void run_online() {
+        if (!prepared_session) {
+            handle_error("run_online needs a prepare_* call first");
+            return;
+        }
 
-        for (int i = 0; i < circuit.n3; i++) {
-            output_bits.push_back(output.get_plaintext_bit(i));
+        if (session_running) {
+            handle_error("A session is already running in this module");
+            return;
         }
 
+        session_running = true;
+        run_online_impl();
+        session_running = false;
+    }
+
+    // Returns 1 if the module is ready for another session, or 0 if the last
+    // one hasn't wound down (it's still waiting in recv, is prepared but not
+    // run, or left channels open), in which case the module should be
+    // discarded.
+    EMSCRIPTEN_KEEPALIVE
+    int reset_session() {
+        return (
+            !session_running &&
+            !prepared_session &&
+            ChannelIOJS::open_channels() == 0
+        );
+    }
+
+    // Joins the threads kept between sessions. Idle pthreads are still
+    // running, which keeps NodeJS alive, so callers release them before
+    // dropping the module. A session that hasn't wound down holds on to
+    // them until it ends. The next session starts them again.
+    EMSCRIPTEN_KEEPALIVE
+    void release_threads() {
+#if EMP_THREADS > 1
+        session_pool.reset();
+#endif
+    }
+}
+
+void run_2pc_impl(int party, int nP) {
+    try {
+        check_2pc_parties(party, nP);
+
+        int other_party = (party == 1) ? 2 : 1;
+
+        auto io = emp::IOChannel(std::make_shared<ChannelIOJS>(other_party, 'a'));
+        auto circuit = get_circuit();
+        check_2pc_input_bits_per_party(*circuit);
+        std::vector<uint8_t> input_bits = get_input_bits(party);
+
+        auto twopc = emp::C2PC(io, party, circuit.get());
+
+        twopc.function_independent();
+
+        // Inputs are known up front, so garble and evaluate in one
+        // streaming pass instead of storing every garbled AND gate.
+        std::vector<uint8_t> output_bits(emp::PackedBits::bytes_for(circuit->n3));
+
+        twopc.online_streaming(
+            emp::PackedBitsView(input_bits.data(), (party == 1) ? circuit->n1 : circuit->n2),
+            emp::PackedBits(output_bits.data(), circuit->n3),
+            true
+        );
+        ChannelIOJS::flush_all();
+        handle_output_bits(output_bits);
+    } catch (const std::exception& e) {
+        handle_error(e.what());
+    }
+}
+
+template <typename Session>
+void run_mpc_impl(int party, int nP) {
+    try {
+        // The inputs are known up front, but CMPC has no streaming pass, so
+        // this is prepare and online back to back.
+        Session session(party, nP);
+        std::vector<uint8_t> output_bits = session.online(get_input_bits(party));
+        ChannelIOJS::flush_all();
+        handle_output_bits(output_bits);
+    } catch (const std::exception& e) {
+        handle_error(e.what());
+    }
+}
+
+void run_sh2pc_impl(int party, int nP) {
+    try {
+        check_2pc_parties(party, nP);
+
+        PreparedSH2PC session(party, nP);
+        std::vector<uint8_t> output_bits = session.online(get_input_bits(party));
+        ChannelIOJS::flush_all();
         handle_output_bits(output_bits);
     } catch (const std::exception& e) {
         handle_error(e.what());
@@ -0,0 +1,233 @@
+// Compares the ways recv_js can wait for data: the ASYNCIFY, JSPI and
+// Atomics.wait builds of jslib.
+//
+// Usage: npm run bench:builds -- [circuit] [parties] [repetitions]
+//
+// Every party runs in its own worker thread, like in browsers, so the
+// Atomics build can block in recv while this thread bridges its rings.
+// Builds that are missing or unsupported here are skipped.
+
+import { Worker, isMainThread, parentPort, workerData } from 'worker_threads';
+import { promises as fs } from 'fs';
+import { join } from 'path';
+import { fileURLToPath, pathToFileURL } from 'url';
+import BufferQueue from '../src/ts/BufferQueue.js';
+import RingBridge from '../src/ts/RingBridge.js';
+import type { IO } from '../src/ts/types';
+import { supportsJspi } from '../src/ts/jspi.js';
+
+const root = join(fileURLToPath(import.meta.url), '../..');
+
+const builds = [
+  { name: 'asyncify', lib: 'build/jslib.js' },
+  { name: 'jspi', lib: 'build/jslib-jspi.js' },
+  { name: 'atomics', lib: 'build/jslib-atomics.js' },
+];
+
+type PartyData = {
+  lib: string,
+  party: number,
+  size: number,
+  circuit: string,
+  inputBitsPerParty: number[],
+};
+
+async function main() {
+  const [
+    circuitPath = 'circuits/sha-1.txt',
+    sizeArg = '2',
+    repsArg = '5',
+  ] = process.argv.slice(2);
+
+  const size = Number(sizeArg);
+  const reps = Number(repsArg);
+  const circuit = await fs.readFile(join(root, circuitPath), 'utf-8');
+
+  // Inputs go to the first two parties, as in the tests
+  const [n1, n2] = circuit.split('\n')[1].trim().split(/\s+/).map(Number);
+  const inputBitsPerParty = new Array(size).fill(0);
+  inputBitsPerParty[0] = n1;
+  inputBitsPerParty[1] = n2;
+
+  console.log(`${circuitPath}, ${size} parties, ${reps} repetitions`);
+
+  for (const build of builds) {
+    const lib = join(root, build.lib);
+
+    try {
+      await fs.access(lib);
+    } catch {
+      console.log(`${build.name}: skipped, ${build.lib} not built`);
+      continue;
+    }
+
+    if (build.name === 'jspi' && !supportsJspi()) {
+      console.log(`${build.name}: skipped, needs --experimental-wasm-jspi`);
+      continue;
+    }
+
+    const times: number[] = [];
+
+    for (let i = 0; i < reps; i++) {
+      const start = performance.now();
+      await runOnce(lib, size, circuit, inputBitsPerParty);
+      times.push(performance.now() - start);
+    }
+
+    times.sort((a, b) => a - b);
+    const median = times[Math.floor(times.length / 2)];
+
+    console.log(
+      `${build.name}: median ${median.toFixed(0)} ms, ` +
+      `min ${times[0].toFixed(0)} ms`,
+    );
+  }
+}
+
+async function runOnce(
+  lib: string,
+  size: number,
+  circuit: string,
+  inputBitsPerParty: number[],
+) {
+  const queues = new Map<string, BufferQueue>();
+
+  const queue = (from: number, to: number, channel: string) => {
+    const key = `${from}-${to}-${channel}`;
+    let q = queues.get(key);
+
+    if (!q) {
+      q = new BufferQueue();
+      queues.set(key, q);
+    }
+
+    return q;
+  };
+
+  const workers: Worker[] = [];
+
+  try {
+    await Promise.all(new Array(size).fill(0).map((_0, party) => {
+      const partyData: PartyData = { lib, party, size, circuit, inputBitsPerParty };
+
+      const io: IO = {
+        send: (toParty, channel, data) => queue(party, toParty, channel).push(data),
+        recv: (fromParty, channel, len) => queue(fromParty, party, channel).pop(len),
+        recvAvailable: (fromParty, channel, minLen, maxLen) => {
+          return queue(fromParty, party, channel).popAvailable(minLen, maxLen);
+        },
+      };
+
+      const rings = new RingBridge(io);
+
+      const worker = new Worker(fileURLToPath(import.meta.url), { workerData: partyData });
+      workers.push(worker);
+
+      return new Promise<void>((resolve, reject) => {
+        worker.on('error', reject);
+
+        worker.on('message', async (message) => {
+          if (message.type === 'io_send') {
+            io.send(message.toParty, message.channel, message.data);
+          } else if (message.type === 'io_recv') {
+            const { fromParty, channel, len, maxLen = len, id } = message;
+            const data = await io.recvAvailable!(fromParty, channel, len, maxLen);
+            worker.postMessage({ id, data });
+          } else if (message.type === 'io_ring_open') {
+            const { otherParty, channel, outPtr, inPtr, memory } = message;
+            rings.open(otherParty, channel, outPtr, inPtr, memory);
+          } else if (message.type === 'io_ring') {
+            rings.doorbell(message.ptr).catch(reject);
+          } else if (message.type === 'result') {
+            resolve();
+          } else if (message.type === 'error') {
+            reject(new Error(message.error));
+          }
+        });
+      });
+    }));
+  } finally {
+    await Promise.all(workers.map(w => w.terminate()));
+  }
+}
+
+async function runParty({
+  lib, party, size, circuit, inputBitsPerParty,
+}: PartyData) {
+  const post = (message: unknown) => parentPort!.postMessage(message);
+
+  const pending = new Map<number, (data: Uint8Array) => void>();
+  let requestId = 0;
+
+  parentPort!.on('message', ({ id, data }) => {
+    pending.get(id)!(data);
+    pending.delete(id);
+  });
+
+  const createModule = (await import(pathToFileURL(lib).href)).default;
+  const module = await createModule();
+
+  // The module takes inputs packed 8 bits to a byte
+  const inputBits = new Uint8Array(Math.ceil(inputBitsPerParty[party] / 8));
+
+  for (let i = 0; i < inputBits.length; i++) {
+    inputBits[i] = Math.floor(Math.random() * 256);
+  }
+
+  module.emp = {
+    circuit,
+    inputBits,
+    inputBitsPerParty,
+    io: {
+      send: (toParty: number, channel: string, data: Uint8Array) => {
+        parentPort!.postMessage(
+          { type: 'io_send', toParty, channel, data },
+          [data.buffer as ArrayBuffer],
+        );
+      },
+      recv: (fromParty: number, channel: string, len: number) => {
+        return new Promise<Uint8Array>(resolve => {
+          const id = requestId++;
+          pending.set(id, resolve);
+          post({ type: 'io_recv', fromParty, channel, len, id });
+        });
+      },
+      recvAvailable: (fromParty: number, channel: string, len: number, maxLen: number) => {
+        return new Promise<Uint8Array>(resolve => {
+          const id = requestId++;
+          pending.set(id, resolve);
+          post({ type: 'io_recv', fromParty, channel, len, maxLen, id });
+        });
+      },
+    },
+
+    rings: {
+      open: (
+        otherParty: number,
+        channel: string,
+        outPtr: number,
+        inPtr: number,
+        memory: SharedArrayBuffer,
+      ) => {
+        post({ type: 'io_ring_open', otherParty, channel, outPtr, inPtr, memory });
+      },
+      doorbell: (ptr: number) => post({ type: 'io_ring', ptr }),
+    },
+    handleOutput: () => post({ type: 'result' }),
+    handleError: (error: Error) => post({ type: 'error', error: error.message }),
+  };
+
+  const method = size === 2 ? '_run_2pc' : '_run_mpc';
+  await module[method](party, size);
+}
+
+if (isMainThread) {
+  main().catch(error => {
+    console.error(error);
+    process.exit(1);
+  });
+} else {
+  runParty(workerData).catch(error => {
+    parentPort!.postMessage({ type: 'error', error: (error as Error).message });
+  });
+}
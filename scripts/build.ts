@@ -32,48 +32,100 @@ async function build() {
     await shell('./scripts/build_mbedtls.sh', [], gitRoot);
   }
 
+  try {
+    await fs.access(join(mbedtlsPath, 'build64'));
+    console.log('mbedtls memory64 build exists.');
+  } catch {
+    console.log('mbedtls memory64 build not found, running build_mbedtls.sh memory64');
+    await shell('./scripts/build_mbedtls.sh', ['memory64'], gitRoot);
+  }
+
+  try {
+    await fs.access(join(mbedtlsPath, 'build-mt'));
+    console.log('mbedtls threads build exists.');
+  } catch {
+    console.log('mbedtls threads build not found, running build_mbedtls.sh threads');
+    await shell('./scripts/build_mbedtls.sh', ['threads'], gitRoot);
+  }
+
   // Run ./build_wasm.sh
   console.log('Running build_wasm.sh');
   await shell('./scripts/build_wasm.sh', [], gitRoot);
 
-  await shell('tsc', [], gitRoot);
+  console.log('Running build_wasm.sh memory64');
+  await shell('./scripts/build_wasm.sh', ['memory64'], gitRoot);
 
-  // We need to fix this in the actual file rather than combining it with
-  // `getEmscriptenCode` because the file itself is used when loading in NodeJS.
-  await fixEmscriptenCode(gitRoot);
+  console.log('Running build_wasm.sh threads');
+  await shell('./scripts/build_wasm.sh', ['threads'], gitRoot);
 
-  await fs.copyFile(
-    join(gitRoot, 'dist/build/jslib.js'),
-    join(gitRoot, 'build/jslib.js'),
-  );
+  console.log('Running build_wasm.sh jspi');
+  await shell('./scripts/build_wasm.sh', ['jspi'], gitRoot);
 
-  const workerCode = [
-    await getEmscriptenCode(),
-    await getAppendWorkerCode(),
-  ].join('\n\n');
+  console.log('Running build_wasm.sh atomics');
+  await shell('./scripts/build_wasm.sh', ['atomics'], gitRoot);
 
-  let workerCodeJs = await fs.readFile(
-    join(gitRoot, 'dist/src/ts/workerCode.js'),
-    'utf-8',
-  );
+  console.log('Running build_wasm.sh threads atomics');
+  await shell('./scripts/build_wasm.sh', ['threads', 'atomics'], gitRoot);
 
-  workerCodeJs = workerCodeJs.replace(
-    `'<<WORKER_CODE>>'`,
-    JSON.stringify(workerCode),
-  );
+  await shell('tsc', [], gitRoot);
 
-  await fs.writeFile(
-    join(gitRoot, 'dist/src/ts/workerCode.js'),
-    workerCodeJs,
-    'utf-8',
-  );
+  for (const lib of ['jslib.js', 'jslib64.js', 'jslib-mt.js', 'jslib-jspi.js']) {
+    // We need to fix this in the actual file rather than combining it with
+    // `getEmscriptenCode` because the file itself is used when loading in
+    // NodeJS.
+    await fixEmscriptenCode(join(gitRoot, 'dist/build', lib));
+
+    await fs.copyFile(
+      join(gitRoot, 'dist/build', lib),
+      join(gitRoot, 'build', lib),
+    );
+  }
+
+  // The atomics builds only run inside browser workers, so NodeJS never
+  // imports them and tsc doesn't copy them to dist.
+  for (const lib of ['jslib-atomics.js', 'jslib-mt-atomics.js']) {
+    await fixEmscriptenCode(join(gitRoot, 'build', lib));
+  }
+
+  for (const [lib, workerCodeFile, placeholder] of [
+    ['jslib.js', 'workerCode.js', 'WORKER_CODE'],
+    ['jslib64.js', 'workerCode64.js', 'WORKER_CODE_64'],
+    ['jslib-jspi.js', 'workerCodeJspi.js', 'WORKER_CODE_JSPI'],
+    ['jslib-atomics.js', 'workerCodeAtomics.js', 'WORKER_CODE_ATOMICS'],
+
+    // Browsers only get threads with SharedArrayBuffer, which is all the
+    // atomics build needs, so their multithreaded worker never uses
+    // ASYNCIFY.
+    ['jslib-mt-atomics.js', 'workerCodeMt.js', 'WORKER_CODE_MT'],
+  ]) {
+    const workerCode = [
+      await getEmscriptenCode(lib),
+      await getAppendWorkerCode(),
+    ].join('\n\n');
+
+    let workerCodeJs = await fs.readFile(
+      join(gitRoot, 'dist/src/ts', workerCodeFile),
+      'utf-8',
+    );
+
+    workerCodeJs = workerCodeJs.replace(
+      `'<<${placeholder}>>'`,
+      JSON.stringify(workerCode),
+    );
+
+    await fs.writeFile(
+      join(gitRoot, 'dist/src/ts', workerCodeFile),
+      workerCodeJs,
+      'utf-8',
+    );
+  }
 }
 
-async function getEmscriptenCode() {
+async function getEmscriptenCode(lib: string) {
   const gitRoot = await getGitRoot();
 
   return await fs.readFile(
-    join(gitRoot, 'build/jslib.js'),
+    join(gitRoot, 'build', lib),
     'utf-8',
   );
 }
@@ -107,8 +159,7 @@ async function shell(cmd: string, args: string[], cwd: string): Promise<void> {
   });
 }
 
-async function fixEmscriptenCode(gitRoot: string) {
-  const path = join(gitRoot, 'dist/build/jslib.js');
+async function fixEmscriptenCode(path: string) {
   let content = await fs.readFile(path, 'utf-8');
 
   content = `function echo(x) { return x; }\n${content}`;
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+set -euo pipefail
+
+mkdir -p build
+
+build() {
+    local out=$1
+    shift
+    clang++ \
+        -O3 \
+        -std=c++17 \
+        "$@" \
+        programs/bench_gfmul.cpp \
+        -I src/cpp/ \
+        -I $(brew --prefix mbedtls)/include \
+        -L $(brew --prefix mbedtls)/lib \
+        -lmbedtls \
+        -lmbedcrypto \
+        -lmbedx509 \
+        -o $out
+}
+
+# AArch64 with the crypto extension always uses PMULL, on x86 the portable
+# backend is compared with a -mpclmul build
+build build/bench_gfmul
+
+if [ "$(uname -m)" = "x86_64" ]; then
+    build build/bench_gfmul_pclmul -mpclmul
+    echo "Build successful, use ./build/bench_gfmul and ./build/bench_gfmul_pclmul to run the benchmark."
+else
+    echo "Build successful, use ./build/bench_gfmul to run the benchmark."
+fi
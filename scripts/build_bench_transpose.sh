@@ -0,0 +1,21 @@
+#!/bin/bash
+
+set -euo pipefail
+
+mkdir -p build
+
+# Add -mavx2 (x86) to include the wider SIMD variant in the comparison
+clang++ \
+    -O3 \
+    -std=c++17 \
+    "$@" \
+    programs/bench_transpose.cpp \
+    -I src/cpp/ \
+    -I $(brew --prefix mbedtls)/include \
+    -L $(brew --prefix mbedtls)/lib \
+    -lmbedtls \
+    -lmbedcrypto \
+    -lmbedx509 \
+    -o build/bench_transpose
+
+echo "Build successful, use ./build/bench_transpose to run the benchmark."
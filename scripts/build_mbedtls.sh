@@ -1,5 +1,7 @@
 #!/bin/bash
 
+# Usage: ./scripts/build_mbedtls.sh [memory64|threads]
+
 set -euo pipefail
 
 # Set variables
@@ -7,6 +9,21 @@ MBEDTLS_REPO="https://github.com/Mbed-TLS/mbedtls.git"
 MBEDTLS_VERSION="v3.6.1"             # The specific release tag of mbed TLS to use
 MBEDTLS_DIR="./external/mbedtls"     # Directory outside your tracked repo for mbedtls
 BUILD_DIR="$MBEDTLS_DIR/build"       # Build directory
+EXTRA_FLAGS=""
+
+if [ "${1:-}" == "memory64" ]; then
+    # wasm64 libraries for ./scripts/build_wasm.sh memory64
+    BUILD_DIR="$MBEDTLS_DIR/build64"
+    EXTRA_FLAGS="-sMEMORY64=1"
+elif [ "${1:-}" == "threads" ]; then
+    # Objects linked into a -pthread module need atomics and bulk memory,
+    # for ./scripts/build_wasm.sh threads
+    BUILD_DIR="$MBEDTLS_DIR/build-mt"
+    EXTRA_FLAGS="-pthread"
+elif [ "${1:-}" != "" ]; then
+    echo "Invalid argument"
+    exit 1
+fi
 EMSDK_PATH=$(dirname $(which emsdk)) # Automatically determine the directory of emsdk
 
 # Set up Emscripten environment
@@ -46,6 +63,7 @@ echo "Configuring mbed TLS for WebAssembly..."
 cmake -S "$MBEDTLS_DIR" -B "$BUILD_DIR" \
     -DCMAKE_TOOLCHAIN_FILE="${EMSCRIPTEN}/cmake/Modules/Platform/Emscripten.cmake" \
     -DCMAKE_BUILD_TYPE=Release \
+    -DCMAKE_C_FLAGS="$EXTRA_FLAGS" \
     -DENABLE_TESTING=OFF \
     -DENABLE_PROGRAMS=OFF
 
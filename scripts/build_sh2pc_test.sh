@@ -0,0 +1,19 @@
+#!/bin/bash
+
+set -euo pipefail
+
+# Note: -D__debug is noticeably slower, but is good for testing
+clang++ \
+    -O3 \
+    -D__debug \
+    -std=c++17 \
+    programs/test_sh2pc.cpp \
+    -I src/cpp/ \
+    -I $(brew --prefix mbedtls)/include \
+    -L $(brew --prefix mbedtls)/lib \
+    -lmbedtls \
+    -lmbedcrypto \
+    -lmbedx509 \
+    -o build/sh2pc
+
+echo "Build successful, use ./scripts/sh2pc_test.sh to run the program."
@@ -0,0 +1,19 @@
+#!/bin/bash
+
+set -euo pipefail
+
+# Note: -D__debug does not seem to impact performance, and is good for testing
+clang++ \
+    -O3 \
+    -std=c++17 \
+    -D__debug \
+    programs/test_shmpc.cpp \
+    -I src/cpp \
+    -I $(brew --prefix mbedtls)/include \
+    -L $(brew --prefix mbedtls)/lib \
+    -lmbedtls \
+    -lmbedcrypto \
+    -lmbedx509 \
+    -o build/shmpc
+
+echo "Build successful, use ./scripts/shmpc_test.sh to run the program."
@@ -1,34 +1,130 @@
 #!/bin/bash
 
-ARG1=$1
+# Usage: ./scripts/build_wasm.sh [debug] [memory64|threads] [atomics|jspi]
+#
+# memory64 builds build/jslib64.js, a wasm64 module that can grow past the
+# 4 GB wasm32 heap. It needs mbedtls built with
+# ./scripts/build_mbedtls.sh memory64.
+#
+# threads builds build/jslib-mt.js with wasm pthreads and a pool of
+# EMP_WASM_THREADS (default 4) workers that the protocol engines share. It
+# needs SharedArrayBuffer, so cross-origin isolation in browsers, and mbedtls
+# built with ./scripts/build_mbedtls.sh threads.
+#
+# atomics drops ASYNCIFY and uses shared wasm memory. Its channels are rings
+# in that memory which the main thread bridges to the network (RingBridge.ts),
+# and recv blocks with Atomics.wait. It adds -atomics to the output name and
+# needs mbedtls built with ./scripts/build_mbedtls.sh threads, for the
+# atomics feature. The module must run in a browser worker whose page is
+# cross-origin isolated, so NodeJS keeps the ASYNCIFY builds.
+#
+# jspi suspends in recv_js with JavaScript Promise Integration, so only the
+# import boundary suspends and the C++ isn't instrumented like with
+# ASYNCIFY. It adds -jspi to the output name and works without
+# SharedArrayBuffer.
 
 set -euo pipefail
 
+DEBUG=""
+MEMORY64=""
+THREADS=""
+ATOMICS=""
+JSPI=""
+
+for ARG in "$@"; do
+  if [ "$ARG" == "debug" ]; then
+    DEBUG=1
+  elif [ "$ARG" == "memory64" ]; then
+    MEMORY64=1
+  elif [ "$ARG" == "threads" ]; then
+    THREADS=1
+  elif [ "$ARG" == "atomics" ]; then
+    ATOMICS=1
+  elif [ "$ARG" == "jspi" ]; then
+    JSPI=1
+  else
+    echo "Invalid argument"
+    exit 1
+  fi
+done
+
 # Variables
 MBEDTLS_DIR="./external/mbedtls"
-BUILD_DIR="$MBEDTLS_DIR/build/library"
+
+THREAD_OPTS=""
+MBEDTLS_VARIANT=""
+
+if [ "$MEMORY64" != "" ] && [ "$THREADS" != "" ]; then
+  echo "memory64 and threads can't be combined"
+  exit 1
+elif [ "$MEMORY64" != "" ]; then
+  BUILD_DIR="$MBEDTLS_DIR/build64/library"
+  OUTPUT_NAME="jslib64"
+  MEMORY_OPTS="-sMEMORY64=1 -sMAXIMUM_MEMORY=16GB"
+  MBEDTLS_VARIANT="memory64"
+elif [ "$THREADS" != "" ]; then
+  WASM_THREADS="${EMP_WASM_THREADS:-4}"
+  BUILD_DIR="$MBEDTLS_DIR/build-mt/library"
+  OUTPUT_NAME="jslib-mt"
+  MEMORY_OPTS="-sMAXIMUM_MEMORY=4GB"
+  # The workers are started with the module, so the engines' pools never
+  # wait on a new Worker while the module's thread is busy.
+  THREAD_OPTS="-pthread -DEMP_THREADS=$WASM_THREADS -sPTHREAD_POOL_SIZE=$WASM_THREADS"
+  MBEDTLS_VARIANT="threads"
+else
+  BUILD_DIR="$MBEDTLS_DIR/build/library"
+  OUTPUT_NAME="jslib"
+  MEMORY_OPTS="-sMAXIMUM_MEMORY=4GB"
+fi
 
 if [ ! -d "$BUILD_DIR" ]; then
-  echo "Please run ./scripts/build_mbedtls.sh first"
+  echo "Please run ./scripts/build_mbedtls.sh${MBEDTLS_VARIANT:+ $MBEDTLS_VARIANT} first"
+  exit 1
+fi
+
+if [ "$ATOMICS" != "" ] && [ "$JSPI" != "" ]; then
+  echo "atomics and jspi can't be combined"
   exit 1
+elif [ "$ATOMICS" != "" ] && [ "$MEMORY64" != "" ]; then
+  echo "memory64 and atomics can't be combined"
+  exit 1
+elif [ "$ATOMICS" != "" ]; then
+  OUTPUT="build/$OUTPUT_NAME-atomics.js"
+  # Nothing suspends, RingIOJS blocks on the shared rings instead. -pthread
+  # already shares the memory.
+  RECV_OPTS="-DEMP_SHARED_RINGS"
+
+  if [ "$THREADS" == "" ]; then
+    RECV_OPTS="$RECV_OPTS -sSHARED_MEMORY"
+    BUILD_DIR="$MBEDTLS_DIR/build-mt/library"
+    MBEDTLS_VARIANT="threads"
+  fi
+elif [ "$JSPI" != "" ]; then
+  OUTPUT="build/$OUTPUT_NAME-jspi.js"
+  # recv_js (EM_ASYNC_JS) becomes a suspending import, and the entry points
+  # that reach it return promises.
+  RECV_OPTS="-sJSPI -sJSPI_EXPORTS=run_2pc,run_mpc,run_sh2pc,run_shmpc,prepare_2pc,prepare_mpc,prepare_sh2pc,prepare_shmpc,run_online"
+else
+  OUTPUT="build/$OUTPUT_NAME.js"
+  RECV_OPTS="-sASYNCIFY -sASYNCIFY_STACK_SIZE=16384"
 fi
 
 mkdir -p build
 
 CONDITIONAL_OPTS=""
 
-if [ "$ARG1" == "" ]; then
+if [ "$DEBUG" == "" ]; then
   CONDITIONAL_OPTS="-O3"
-elif [ "$ARG1" == "debug" ]; then
-  CONDITIONAL_OPTS="-g -D__debug"
 else
-  echo "Invalid argument"
-  exit 1
+  CONDITIONAL_OPTS="-g -D__debug"
 fi
 
 # Emscripten build
-em++ programs/jslib.cpp -sASYNCIFY -o build/jslib.js \
+em++ programs/jslib.cpp -o "$OUTPUT" \
   $CONDITIONAL_OPTS \
+  $MEMORY_OPTS \
+  $THREAD_OPTS \
+  $RECV_OPTS \
   -Wall \
   -Wextra \
   -pedantic \
@@ -46,9 +142,8 @@ em++ programs/jslib.cpp -sASYNCIFY -o build/jslib.js \
   -sNO_DISABLE_EXCEPTION_CATCHING \
   -sASSERTIONS=1 \
   -sSTACK_SIZE=8388608 \
-  -sASYNCIFY_STACK_SIZE=16384 \
-  -sEXPORTED_FUNCTIONS=['_js_malloc','_main'] \
-  -sEXPORTED_RUNTIME_METHODS=['HEAPU8','setValue'] \
+  -sEXPORTED_FUNCTIONS=['_main'] \
+  -sEXPORTED_RUNTIME_METHODS=['HEAPU8'] \
   -s MODULARIZE=1 \
   -s EXPORT_ES6=1 \
   -s EXPORT_NAME=createModule
@@ -58,6 +58,11 @@ public:
         labels = new block[cf->num_wire];
 
         mask = new bool[cf->n1 + cf->n2];
+
+        if(party == ALICE and garble_threads > 1)
+            pool = shared_thread_pool(garble_threads);
+        if(party == BOB and eval_threads > 1)
+            pool = shared_thread_pool(eval_threads);
     }
     ~C2PC(){
         delete[] key;
@@ -77,7 +82,11 @@ public:
         delete fpre;
     }
     PRG prg;
+    // fixed key, so ECB calls only read it and the evaluator threads share it
     PRP prp;
+    // Alice garbles AND gate ranges on this, Bob spreads each circuit
+    // level's AND gates over it in online
+    std::shared_ptr<ThreadPool> pool;
     block (* GT)[4][2] = nullptr;
     block (* GTK)[4] = nullptr;
     block (* GTM)[4] = nullptr;
@@ -105,6 +114,208 @@ public:
     }
 
     void function_dependent() {
+        prepare_and_gates();
+
+        GT = new block[num_ands][4][2];
+        GTK = new block[num_ands][4];
+        GTM = new block[num_ands][4];
+
+        if(party == ALICE and pool) {
+            garble_parallel();
+            open_input_masks();
+            return;
+        }
+
+        int ands = 0;
+        block H[4][2];
+        block K[4], M[4];
+        for(int i = 0; i < cf->num_gate; ++i) {
+            if(cf->gates[4*i+3] == AND_GATE) {
+                and_rows(i, ands, K, M);
+                if(party == ALICE) {
+                    garble_and(i, K, M, H);
+#ifdef __debug
+                    for(int j = 0; j < 4; ++j)
+                        check2(M[j], K[j]);
+#endif
+                    send_and(H);
+                } else {
+                    memcpy(GTK[ands], K, sizeof(block)*4);
+                    memcpy(GTM[ands], M, sizeof(block)*4);
+#ifdef __debug
+                    for(int j = 0; j < 4; ++j)
+                        check2(M[j], K[j]);
+#endif
+                    recv_and(GT[ands]);
+                }
+                ++ands;
+            }
+        }
+
+        open_input_masks();
+    }
+
+    std::vector<bool> online(
+        const std::vector<bool>& input,
+        bool alice_output = false
+    ) {
+        std::vector<bool> output(cf->n3);
+        online_into(input, alice_output, [&](int i, bool bit) { output[i] = bit; });
+        return output;
+    }
+
+    /*
+     * online with inputs and outputs packed 8 bits to a byte, output must
+     * hold cf->n3 bits.
+     */
+    void online(PackedBitsView input, PackedBits output, bool alice_output = false) {
+        check_output_size(output);
+        online_into(input, alice_output, [&](int i, bool bit) { output.set(i, bit); });
+    }
+
+    /*
+     * function_dependent and online in one pass, for when the inputs are
+     * already known. Alice sends the garbled AND gates in windows of
+     * `window` gates while Bob evaluates each window as it arrives and then
+     * drops it, so garbling overlaps with transfer and evaluation.
+     * Only the tables (128 bytes per AND gate) are bounded by the window:
+     * Bob still holds the keys, MACs and labels of every wire and the sigma
+     * shares of every AND gate (32 bytes each). The preprocessed shares and
+     * AND triples are freed once the gates are prepared.
+     * Both parties must use this instead of function_dependent + online.
+     */
+    std::vector<bool> online_streaming(
+        const std::vector<bool>& input,
+        bool alice_output = false,
+        int window = 4096
+    ) {
+        std::vector<bool> output(cf->n3);
+        online_streaming_into(input, alice_output, window, [&](int i, bool bit) {
+            output[i] = bit;
+        });
+        return output;
+    }
+
+    void online_streaming(
+        PackedBitsView input,
+        PackedBits output,
+        bool alice_output = false,
+        int window = 4096
+    ) {
+        check_output_size(output);
+        online_streaming_into(input, alice_output, window, [&](int i, bool bit) {
+            output.set(i, bit);
+        });
+    }
+
+    // Input is anything indexable by bit with a size(), set_output(i, bit)
+    // receives each output bit
+    template<typename Input, typename SetOutput>
+    void online_into(const Input& input, bool alice_output, SetOutput set_output) {
+        check_input_size(input);
+
+        uint8_t * mask_input = new uint8_t[cf->num_wire];
+#ifdef __debug
+        for(int i = 0; i < cf->n1+cf->n2; ++i)
+            check2(mac[i], key[i]);
+#endif
+        exchange_inputs(input, mask_input);
+        if(party == BOB and pool) {
+            evaluate_levels(mask_input);
+        } else if(party == BOB) {
+            evaluate(mask_input, [&](int /*i*/, int ands, block (*&gt)[2], block *&gtk, block *&gtm) {
+                gt = GT[ands];
+                gtk = GTK[ands];
+                gtm = GTM[ands];
+            });
+        }
+        reveal_outputs(mask_input, alice_output, set_output);
+        delete[] mask_input;
+    }
+
+    // online_streaming, with Input and SetOutput as in online_into
+    template<typename Input, typename SetOutput>
+    void online_streaming_into(
+        const Input& input,
+        bool alice_output,
+        int window,
+        SetOutput set_output
+    ) {
+        check_input_size(input);
+        if(window < 1)
+            throw std::invalid_argument("window must be positive");
+
+        prepare_and_gates();
+        release_preprocessing();
+        open_input_masks();
+
+        // Unlike function_dependent + online, the masked inputs are exchanged
+        // before any garbled table is sent, so Bob can evaluate each window
+        // as it arrives. This tells Alice nothing new when she garbles: every
+        // masked value is XORed with a wire mask that has a share only Bob
+        // knows, so it is uniform whatever Bob's input, and the tables are
+        // fixed by the labels, Delta and the authenticated shares from
+        // preprocessing. A table she changes after seeing them still fails
+        // Bob's MAC check in eval_and on a row chosen by those uniform values.
+        uint8_t * mask_input = new uint8_t[cf->num_wire];
+        exchange_inputs(input, mask_input);
+
+        block K[4], M[4];
+        if(party == ALICE and pool) {
+            garble_parallel(window);
+        } else if(party == ALICE) {
+            int ands = 0;
+            block H[4][2];
+            for(int i = 0; i < cf->num_gate; ++i) {
+                if(cf->gates[4*i+3] == AND_GATE) {
+                    and_rows(i, ands, K, M);
+                    garble_and(i, K, M, H);
+                    send_and(H);
+                    if(++ands % window == 0)
+                        io.flush();
+                }
+            }
+            io.flush();
+        } else {
+            block (* GTw)[4][2] = new block[std::min(window, std::max(num_ands, 1))][4][2];
+            evaluate(mask_input, [&](int i, int ands, block (*&gt)[2], block *&gtk, block *&gtm) {
+                if(ands % window == 0) {
+                    int len = std::min(window, num_ands - ands);
+                    for(int j = 0; j < len; ++j)
+                        recv_and(GTw[j]);
+                }
+                and_rows(i, ands, K, M);
+                gt = GTw[ands % window];
+                gtk = K;
+                gtm = M;
+            });
+            delete[] GTw;
+        }
+
+        reveal_outputs(mask_input, alice_output, set_output);
+        delete[] mask_input;
+    }
+
+    template<typename Input>
+    void check_input_size(const Input& input) {
+        size_t correct_input_size = party == ALICE ? cf->n1 : cf->n2;
+
+        if (input.size() != correct_input_size) {
+            throw std::invalid_argument("input size does not match circuit");
+        }
+    }
+
+    // Also clears it, Alice only learns the output with alice_output
+    void check_output_size(PackedBits output) {
+        if (output.size() != size_t(cf->n3)) {
+            throw std::invalid_argument("output size does not match circuit");
+        }
+
+        memset(output.data, 0, PackedBits::bytes_for(output.size()));
+    }
+
+    // Wire masks, the x/y openings and sigma of every AND gate
+    void prepare_and_gates() {
         int ands = cf->n1+cf->n2;
         bool * x1 = new bool[num_ands];
         bool * y1 = new bool[num_ands];
@@ -186,64 +397,133 @@ public:
         delete[] fpre->KEY;
         fpre->MAC = nullptr;
         fpre->KEY = nullptr;
-        GT = new block[num_ands][4][2];
-        GTK = new block[num_ands][4];
-        GTM = new block[num_ands][4];
+        delete[] x1;
+        delete[] x2;
+        delete[] y1;
+        delete[] y2;
+    }
 
-        ands = 0;
-        block H[4][2];
-        block K[4], M[4];
-        for(int i = 0; i < cf->num_gate; ++i) {
-            if(cf->gates[4*i+3] == AND_GATE) {
-                M[0] = sigma_mac[ands] ^ mac[cf->gates[4*i+2]];
-                M[1] = M[0] ^ mac[cf->gates[4*i]];
-                M[2] = M[0] ^ mac[cf->gates[4*i+1]];
-                M[3] = M[1] ^ mac[cf->gates[4*i+1]];
-                if(party == BOB)
-                    M[3] = M[3] ^ fpre->one;
-
-                K[0] = sigma_key[ands] ^ key[cf->gates[4*i+2]];
-                K[1] = K[0] ^ key[cf->gates[4*i]];
-                K[2] = K[0] ^ key[cf->gates[4*i+1]];
-                K[3] = K[1] ^ key[cf->gates[4*i+1]];
-                if(party == ALICE)
-                    K[3] = K[3] ^ fpre->ZDelta;
+    // After prepare_and_gates, online only needs the wire shares and sigma
+    void release_preprocessing() {
+        delete[] preprocess_mac;
+        delete[] preprocess_key;
+        preprocess_mac = nullptr;
+        preprocess_key = nullptr;
+
+        delete[] fpre->MAC_res;
+        delete[] fpre->KEY_res;
+        fpre->MAC_res = nullptr;
+        fpre->KEY_res = nullptr;
+        ANDS_mac = nullptr;
+        ANDS_key = nullptr;
+    }
 
-                if(party == ALICE) {
-                    Hash(H, labels[cf->gates[4*i]], labels[cf->gates[4*i+1]], i);
-                    for(int j = 0; j < 4; ++j) {
-                        H[j][0] = H[j][0] ^ M[j];
-                        H[j][1] = H[j][1] ^ K[j] ^ labels[cf->gates[4*i+2]];
-                        if(getLSB(M[j]))
-                            H[j][1] = H[j][1] ^fpre->Delta;
-#ifdef __debug
-                        check2(M[j], K[j]);
-#endif
-                    }
-                    for(int j = 0; j < 4; ++j ) {
-                        send_partial_block<SSP>(io, &H[j][0], 1);
-                        io.send_block(&H[j][1], 1);
-                    }
-                } else {
-                    memcpy(GTK[ands], K, sizeof(block)*4);
-                    memcpy(GTM[ands], M, sizeof(block)*4);
-#ifdef __debug
-                    for(int j = 0; j < 4; ++j)
-                        check2(M[j], K[j]);
-#endif
-                    for(int j = 0; j < 4; ++j ) {
-                        recv_partial_block<SSP>(io, &GT[ands][j][0], 1);
-                        io.recv_block(&GT[ands][j][1], 1);
-                    }
+    // MAC and KEY shares of the four rows of AND gate i (the ands-th)
+    void and_rows(int i, int ands, block K[4], block M[4]) {
+        M[0] = sigma_mac[ands] ^ mac[cf->gates[4*i+2]];
+        M[1] = M[0] ^ mac[cf->gates[4*i]];
+        M[2] = M[0] ^ mac[cf->gates[4*i+1]];
+        M[3] = M[1] ^ mac[cf->gates[4*i+1]];
+        if(party == BOB)
+            M[3] = M[3] ^ fpre->one;
+
+        K[0] = sigma_key[ands] ^ key[cf->gates[4*i+2]];
+        K[1] = K[0] ^ key[cf->gates[4*i]];
+        K[2] = K[0] ^ key[cf->gates[4*i+1]];
+        K[3] = K[1] ^ key[cf->gates[4*i+1]];
+        if(party == ALICE)
+            K[3] = K[3] ^ fpre->ZDelta;
+    }
+
+    void garble_and(int i, const block K[4], const block M[4], block H[4][2]) {
+        Hash(H, labels[cf->gates[4*i]], labels[cf->gates[4*i+1]], i);
+        for(int j = 0; j < 4; ++j) {
+            H[j][0] = H[j][0] ^ M[j];
+            H[j][1] = H[j][1] ^ K[j] ^ labels[cf->gates[4*i+2]];
+            if(getLSB(M[j]))
+                H[j][1] = H[j][1] ^fpre->Delta;
+        }
+    }
+
+    /*
+     * Alice's garbling with the AND gates split into contiguous ranges of
+     * `range` gates. The pool garbles ranges into their own buffers (in
+     * send_and's wire format) while the calling thread sends finished
+     * buffers in order, so the bytes on the wire are the same as the
+     * sequential loop. With a window, io is flushed whenever a window of
+     * gates has been sent, as online_streaming does.
+     */
+    void garble_parallel(int window = 0, int range = 1024) {
+        const int gate_bytes = 4 * (SSP + sizeof(block));
+        std::vector<int> and_gates;
+        and_gates.reserve(num_ands);
+        for(int i = 0; i < cf->num_gate; ++i)
+            if(cf->gates[4*i+3] == AND_GATE)
+                and_gates.push_back(i);
+
+        int num_ranges = (num_ands + range - 1) / range;
+        int slots = std::min(2 * (pool->size() + 1), std::max(num_ranges, 1));
+        std::vector<std::vector<char>> buf(slots, std::vector<char>((size_t)range * gate_bytes));
+        std::vector<std::future<void>> pending(slots);
+
+        auto garble_range = [this, range, &and_gates, &buf, slots](int r) {
+            block H[4][2];
+            block K[4], M[4];
+            char * out = buf[r % slots].data();
+            int end = std::min(num_ands, (r + 1) * range);
+            for(int ands = r * range; ands < end; ++ands) {
+                and_rows(and_gates[ands], ands, K, M);
+                garble_and(and_gates[ands], K, M, H);
+                for(int j = 0; j < 4; ++j) {
+                    memcpy(out, &H[j][0], SSP);
+                    memcpy(out + SSP, &H[j][1], sizeof(block));
+                    out += SSP + sizeof(block);
                 }
-                ++ands;
             }
+        };
+
+        auto send_range = [&](int r) {
+            int start = r * range, end = std::min(num_ands, start + range);
+            pending[r % slots].get();
+            io.send_data(buf[r % slots].data(), (size_t)(end - start) * gate_bytes);
+            if(window > 0 and end / window != start / window)
+                io.flush();
+        };
+
+        try {
+            for(int r = 0; r < num_ranges; ++r) {
+                if(r >= slots)
+                    send_range(r - slots);
+                pending[r % slots] = pool->enqueue(garble_range, r);
+            }
+            for(int r = std::max(num_ranges - slots, 0); r < num_ranges; ++r)
+                send_range(r);
+        } catch(...) {
+            // the tasks write into buf, so they must finish before it goes away
+            for(std::future<void>& p : pending)
+                if(p.valid())
+                    p.wait();
+            throw;
         }
-        delete[] x1;
-        delete[] x2;
-        delete[] y1;
-        delete[] y2;
+        if(window > 0)
+            io.flush();
+    }
+
+    void send_and(block H[4][2]) {
+        for(int j = 0; j < 4; ++j ) {
+            send_partial_block<SSP>(io, &H[j][0], 1);
+            io.send_block(&H[j][1], 1);
+        }
+    }
 
+    void recv_and(block GT[4][2]) {
+        for(int j = 0; j < 4; ++j ) {
+            recv_partial_block<SSP>(io, &GT[j][0], 1);
+            io.recv_block(&GT[j][1], 1);
+        }
+    }
+
+    void open_input_masks() {
         block tmp;
         if(party == ALICE) {
             send_partial_block<SSP>(io, mac+cf->n1, cf->n2);
@@ -279,25 +559,11 @@ public:
         io.flush();
     }
 
-    std::vector<bool> online(
-        const std::vector<bool>& input,
-        bool alice_output = false
-    ) {
-        std::vector<bool> output(cf->n3);
-
-        size_t correct_input_size = party == ALICE ? cf->n1 : cf->n2;
-
-        if (input.size() != correct_input_size) {
-            throw std::invalid_argument("input size does not match circuit");
-        }
-
-        uint8_t * mask_input = new uint8_t[cf->num_wire];
+    // Masked input values of both parties, Bob also gets the input labels
+    template<typename Input>
+    void exchange_inputs(const Input& input, uint8_t * mask_input) {
         memset(mask_input, 0, cf->num_wire);
         block tmp;
-#ifdef __debug
-        for(int i = 0; i < cf->n1+cf->n2; ++i)
-            check2(mac[i], key[i]);
-#endif
         if(party == ALICE) {
             for(int i = 0; i < cf->n1; ++i) {
                 mask_input[i] = logic_xor(input[i], getLSB(mac[i]));
@@ -310,8 +576,6 @@ public:
                 if(mask_input[i]) tmp = tmp ^ fpre->Delta;
                 io.send_block(&tmp, 1);
             }
-            //send output mask data
-            send_partial_block<SSP>(io, mac+cf->num_wire - cf->n3, cf->n3);
         } else {
             for(int i = cf->n1; i < cf->n1+cf->n2; ++i) {
                 mask_input[i] = logic_xor(input[i-cf->n1], getLSB(mac[i]));
@@ -321,39 +585,83 @@ public:
             io.recv_data(mask_input, cf->n1);
             io.recv_block(labels, cf->n1 + cf->n2);
         }
+    }
+
+    // Bob's pass over the circuit, table(i, ands, gt, gtk, gtm) points the
+    // last three at the garbled rows of the ands-th AND gate (gate i)
+    template<typename T>
+    void evaluate(uint8_t * mask_input, T table) {
         int ands = 0;
-        if(party == BOB) {
-            for(int i = 0; i < cf->num_gate; ++i) {
-                if (cf->gates[4*i+3] == XOR_GATE) {
-                    labels[cf->gates[4*i+2]] = labels[cf->gates[4*i]] ^ labels[cf->gates[4*i+1]];
-                    mask_input[cf->gates[4*i+2]] = logic_xor(mask_input[cf->gates[4*i]], mask_input[cf->gates[4*i+1]]);
-                } else if (cf->gates[4*i+3] == AND_GATE) {
-                    int index = 2*mask_input[cf->gates[4*i]] + mask_input[cf->gates[4*i+1]];
-                    block H[2];
-                    Hash(H, labels[cf->gates[4*i]], labels[cf->gates[4*i+1]], i, index);
-                    GT[ands][index][0] = GT[ands][index][0] ^ H[0];
-                    GT[ands][index][1] = GT[ands][index][1] ^ H[1];
-
-                    block ttt = GTK[ands][index] ^ fpre->Delta;
-                    ttt =  ttt & MASK;
-                    GTK[ands][index] =  GTK[ands][index] & MASK;
-                    GT[ands][index][0] =  GT[ands][index][0] & MASK;
-
-                    if(cmpBlock(&GT[ands][index][0], &GTK[ands][index], 1))
-                        mask_input[cf->gates[4*i+2]] = false;
-                    else if(cmpBlock(&GT[ands][index][0], &ttt, 1))
-                        mask_input[cf->gates[4*i+2]] = true;
-                    else throw std::runtime_error(std::to_string(ands) + " no match GT!");
-                    mask_input[cf->gates[4*i+2]] = logic_xor(mask_input[cf->gates[4*i+2]], getLSB(GTM[ands][index]));
-
-                    labels[cf->gates[4*i+2]] = GT[ands][index][1] ^ GTM[ands][index];
-                    ands++;
-                } else {
-                    mask_input[cf->gates[4*i+2]] = not mask_input[cf->gates[4*i]];
-                    labels[cf->gates[4*i+2]] = labels[cf->gates[4*i]];
-                }
+        block (* gt)[2];
+        block * gtk, * gtm;
+        for(int i = 0; i < cf->num_gate; ++i) {
+            if (cf->gates[4*i+3] == AND_GATE) {
+                table(i, ands, gt, gtk, gtm);
+                eval_and(i, ands, mask_input, gt, gtk, gtm);
+                ands++;
+            } else {
+                eval_free(i, mask_input);
             }
         }
+    }
+
+    /*
+     * Bob's pass over the circuit by AND depth. The AND gates of one level
+     * are independent, so they are handed to the pool in batches of
+     * `batch` and idle threads pick up the remaining batches. Needs every
+     * garbled table up front, so online_streaming keeps using evaluate.
+     */
+    void evaluate_levels(uint8_t * mask_input, int batch = 64) {
+        CircuitLevels levels(*cf);
+        for(const CircuitLevels::Level& level : levels.levels) {
+            for(int i : level.free_gates)
+                eval_free(i, mask_input);
+
+            int64_t num_batches = (level.and_gates.size() + batch - 1) / batch;
+            pool->parallel_for(num_batches, [&](int64_t b) {
+                size_t end = std::min(level.and_gates.size(), (size_t)(b+1)*batch);
+                for(size_t k = b*batch; k < end; ++k) {
+                    int ands = level.and_ids[k];
+                    eval_and(level.and_gates[k], ands, mask_input, GT[ands], GTK[ands], GTM[ands]);
+                }
+            });
+        }
+    }
+
+    void eval_free(int i, uint8_t * mask_input) {
+        if (cf->gates[4*i+3] == XOR_GATE) {
+            labels[cf->gates[4*i+2]] = labels[cf->gates[4*i]] ^ labels[cf->gates[4*i+1]];
+            mask_input[cf->gates[4*i+2]] = logic_xor(mask_input[cf->gates[4*i]], mask_input[cf->gates[4*i+1]]);
+        } else {
+            mask_input[cf->gates[4*i+2]] = not mask_input[cf->gates[4*i]];
+            labels[cf->gates[4*i+2]] = labels[cf->gates[4*i]];
+        }
+    }
+
+    void eval_and(int i, int ands, uint8_t * mask_input, block GT[4][2], block GTK[4], const block GTM[4]) {
+        int index = 2*mask_input[cf->gates[4*i]] + mask_input[cf->gates[4*i+1]];
+        block H[2];
+        Hash(H, labels[cf->gates[4*i]], labels[cf->gates[4*i+1]], i, index);
+        GT[index][0] = GT[index][0] ^ H[0];
+        GT[index][1] = GT[index][1] ^ H[1];
+
+        block ttt = GTK[index] ^ fpre->Delta;
+        ttt =  ttt & MASK;
+        GTK[index] =  GTK[index] & MASK;
+        GT[index][0] =  GT[index][0] & MASK;
+
+        if(cmpBlock(&GT[index][0], &GTK[index], 1))
+            mask_input[cf->gates[4*i+2]] = false;
+        else if(cmpBlock(&GT[index][0], &ttt, 1))
+            mask_input[cf->gates[4*i+2]] = true;
+        else throw std::runtime_error(std::to_string(ands) + " no match GT!");
+        mask_input[cf->gates[4*i+2]] = logic_xor(mask_input[cf->gates[4*i+2]], getLSB(GTM[index]));
+
+        labels[cf->gates[4*i+2]] = GT[index][1] ^ GTM[index];
+    }
+
+    template<typename SetOutput>
+    void reveal_outputs(uint8_t * mask_input, bool alice_output, SetOutput set_output) {
         if (party == BOB) {
             bool * o = new bool[cf->n3];
             for(int i = 0; i < cf->n3; ++i) {
@@ -372,8 +680,8 @@ public:
                 else throw std::runtime_error("no match output label!");
             }
             for(int i = 0; i < cf->n3; ++i) {
-                output[i] = logic_xor(o[i], mask_input[cf->num_wire - cf->n3 + i]);
-                output[i] = logic_xor(output[i], getLSB(mac[cf->num_wire - cf->n3 + i]));
+                bool bit = logic_xor(o[i], mask_input[cf->num_wire - cf->n3 + i]);
+                set_output(i, logic_xor(bit, getLSB(mac[cf->num_wire - cf->n3 + i])));
             }
             delete[] o;
             if(alice_output) {
@@ -383,6 +691,8 @@ public:
                 io.flush();
             }
         } else {//ALICE
+            //send output mask data
+            send_partial_block<SSP>(io, mac+cf->num_wire - cf->n3, cf->n3);
             if(alice_output) {
                 block * tmp_mac = new block[cf->n3];
                 block * tmp_label = new block[cf->n3];
@@ -399,10 +709,11 @@ public:
                     ttt =  ttt & MASK;
                     key[cf->num_wire - cf-> n3 + i] = key[cf->num_wire - cf-> n3 + i] & MASK;
 
+                    bool bit;
                     if(cmpBlock(&tmp, &key[cf->num_wire - cf-> n3 + i], 1))
-                        output[i] = false;
+                        bit = false;
                     else if(cmpBlock(&tmp, &ttt, 1))
-                        output[i] = true;
+                        bit = true;
                     else throw std::runtime_error("no match output label!");
                     block mask_label = tmp_label[i];
                     if(tmp_mask_input[i])
@@ -412,18 +723,14 @@ public:
                     if(!cmpBlock(&mask_label, &masked_labels, 1))
                         throw std::runtime_error("no match output label2!");
 
-                    output[i] = logic_xor(output[i], tmp_mask_input[i]);
-                    output[i] = logic_xor(output[i], getLSB(mac[cf->num_wire - cf->n3 + i]));
+                    bit = logic_xor(bit, tmp_mask_input[i]);
+                    set_output(i, logic_xor(bit, getLSB(mac[cf->num_wire - cf->n3 + i])));
                 }
                 delete[] tmp_mac;
                 delete[] tmp_label;
                 delete[] tmp_mask_input;
             }
-
         }
-        delete[] mask_input;
-
-        return output;
     }
 
     void check(block * MAC, block * KEY, bool * r, int length = 1) {
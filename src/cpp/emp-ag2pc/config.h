@@ -1,7 +1,15 @@
 #ifndef EMP_AG2PC_CONFIG_H
 #define EMP_AG2PC_CONFIG_H
+#include "emp-tool/utils/thread_pool.h"
 namespace emp {
 const static char * IP = "127.0.0.1";
 //const static char * IP = "172.31.10.128";
+// threads used by the OT extension in Fpre, 1 keeps it on the calling thread
+const static int ot_threads = EMP_THREADS;
+// threads Bob evaluates each circuit level with in online, 1 keeps the
+// sequential pass
+const static int eval_threads = EMP_THREADS;
+// threads Alice garbles AND gates with, 1 keeps the sequential loop
+const static int garble_threads = EMP_THREADS;
 }
 #endif// __C2PC_CONFIG
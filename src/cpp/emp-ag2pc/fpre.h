@@ -13,7 +13,7 @@ namespace emp {
 class Fpre {
     public:
         IOChannel io;
-        int batch_size = 0, bucket_size = 0, size = 0;
+        int64_t batch_size = 0, bucket_size = 0, size = 0;
         int party;
         block * keys = nullptr;
         bool * values = nullptr;
@@ -28,6 +28,7 @@ class Fpre {
         block * MAC = nullptr, *KEY = nullptr;
         block * MAC_res = nullptr, *KEY_res = nullptr;
         block * pretable = nullptr;
+        std::shared_ptr<ThreadPool> pool;
         Fpre(IOChannel io, int in_party, int bsize = 1000): io(io) {
             prps = new PRP[2];
             this->party = in_party;
@@ -54,14 +55,10 @@ class Fpre {
             }
             io.flush();
 
-            abit1 = new LeakyDeltaOT(io);
-            abit2 = new LeakyDeltaOT(io);
-            if(party == ALICE) {
-                abit1->setup_send(tmp_s, abit1->k0);
-                abit2->setup_recv(abit2->k0, abit2->k1);
-            } else {
-                abit2->setup_send(tmp_s, abit2->k0);
-                abit1->setup_recv(abit1->k0, abit1->k1);
+            if(ot_threads > 1) {
+                pool = shared_thread_pool(ot_threads);
+                abit1->pool = pool.get();
+                abit2->pool = pool.get();
             }
 
             if(party == ALICE) Delta = abit1->Delta;
@@ -71,8 +68,8 @@ class Fpre {
             set_batch_size(bsize);
         }
         int permute_batch_size;
-        void set_batch_size(int size) {
-            size = std::max(size, 320);
+        void set_batch_size(int64_t size) {
+            size = std::max<int64_t>(size, 320);
             batch_size = ((size+1)/2)*2;
             if(batch_size >= 280*1000) {
                 bucket_size = 3;
@@ -108,8 +105,8 @@ class Fpre {
         void refill() {
             auto start_time = clock_start();
 
-            int start = 0;
-            int length = batch_size;
+            int64_t start = 0;
+            int64_t length = batch_size;
 
             generate(MAC + start * bucket_size*3, KEY + start * bucket_size*3, length * bucket_size);
 
@@ -119,8 +116,8 @@ class Fpre {
             }
 
             for(int i = 0; i < 2; ++i) {
-                int start = i*(batch_size/2);
-                int length = batch_size/2;
+                int64_t start = i*(batch_size/2);
+                int64_t length = batch_size/2;
                 check(MAC + start * bucket_size*3, KEY + start * bucket_size*3, length * bucket_size, i);
             }
             if(party == ALICE) {
@@ -135,10 +132,10 @@ class Fpre {
             if(bucket_size > 4) {
                 combine(S, 0, MAC, KEY, batch_size, bucket_size, MAC_res, KEY_res);
             } else {
-                int width = min((batch_size), permute_batch_size);
+                int64_t width = std::min<int64_t>(batch_size, permute_batch_size);
 
-                int start = 0;
-                int length = min(width, batch_size);
+                int64_t start = 0;
+                int64_t length = std::min(width, batch_size);
                 combine(S, 0, MAC+start*bucket_size*3, KEY+start*bucket_size*3, length, bucket_size, MAC_res+start*3, KEY_res+start*3);
             }
             if(party == ALICE) {
@@ -159,7 +156,7 @@ class Fpre {
             }
         }
 
-        void generate(block * MAC, block * KEY, int length) {
+        void generate(block * MAC, block * KEY, int64_t length) {
             if (party == ALICE) {
                 abit1->send_dot(KEY, length*3);
                 abit2->recv_dot(MAC, length*3);
@@ -172,14 +169,14 @@ class Fpre {
             }
         }
 
-        void check(block * MAC, block * KEY, int length, int I) {
+        void check(block * MAC, block * KEY, int64_t length, int I) {
             block * G = new block[length];
             block * C = new block[length];
             block * GR = new block[length];
             bool * d = new bool[length];
             bool * dR = new bool[length];
 
-            for (int i = 0; i < length; ++i) {
+            for (int64_t i = 0; i < length; ++i) {
                 C[i] = KEY[3*i+1] ^ MAC[3*i+1];
                 C[i] = C[i] ^ (select_mask[getLSB(MAC[3*i+1])] & Delta);
                 G[i] = H2D(KEY[3*i], Delta, I);
@@ -193,7 +190,7 @@ class Fpre {
                 io.send_data(G, sizeof(block)*length);
             }
             io.flush();
-            for(int i = 0; i < length; ++i) {
+            for(int64_t i = 0; i < length; ++i) {
                 block S = H2(MAC[3*i], KEY[3*i], I);
                 S = S ^ MAC[3*i+2] ^ KEY[3*i+2];
                 S = S ^ (select_mask[getLSB(MAC[3*i])] & (GR[i] ^ C[i]));
@@ -209,7 +206,7 @@ class Fpre {
                 io.send_bool(d, length);
             }
             io.flush();
-            for(int i = 0; i < length; ++i) {
+            for(int64_t i = 0; i < length; ++i) {
                 d[i] = d[i] != dR[i];
                 if (d[i]) {
                     if(party == ALICE)
@@ -251,16 +248,16 @@ class Fpre {
             return ((x >> 1) & 0x1) == 1;
         }
 
-        void combine(block S, int I, block * MAC, block * KEY, int length, int bucket_size, block * MAC_res, block * KEY_res) {
-            int *location = new int[length*bucket_size];
-            for(int i = 0; i < length*bucket_size; ++i) location[i] = i;
+        void combine(block S, int I, block * MAC, block * KEY, int64_t length, int64_t bucket_size, block * MAC_res, block * KEY_res) {
+            int64_t *location = new int64_t[length*bucket_size];
+            for(int64_t i = 0; i < length*bucket_size; ++i) location[i] = i;
             PRG prg(&S, I);
             int * ind = new int[length*bucket_size];
             prg.random_data(ind, length*bucket_size*4);
-            for(int i = length*bucket_size-1; i>=0; --i) {
-                int index = ind[i]%(i+1);
+            for(int64_t i = length*bucket_size-1; i>=0; --i) {
+                int64_t index = ind[i]%(i+1);
                 index = index>0? index:(-1*index);
-                int tmp = location[i];
+                int64_t tmp = location[i];
                 location[i] = location[index];
                 location[index] = tmp;
             }
@@ -268,8 +265,8 @@ class Fpre {
 
             bool *data = new bool[length*bucket_size];
             bool *data2 = new bool[length*bucket_size];
-            for(int i = 0; i < length; ++i) {
-                for(int j = 1; j < bucket_size; ++j) {
+            for(int64_t i = 0; i < length; ++i) {
+                for(int64_t j = 1; j < bucket_size; ++j) {
                     data[i*bucket_size+j] = getLSB(MAC[location[i*bucket_size]*3+1] ^ MAC[location[i*bucket_size+j]*3+1]);
                 }
             }
@@ -281,17 +278,17 @@ class Fpre {
                 io.send_bool(data, length*bucket_size);
             }
             io.flush();
-            for(int i = 0; i < length; ++i) {
-                for(int j = 1; j < bucket_size; ++j) {
+            for(int64_t i = 0; i < length; ++i) {
+                for(int64_t j = 1; j < bucket_size; ++j) {
                     data[i*bucket_size+j] = (data[i*bucket_size+j] != data2[i*bucket_size+j]);
                 }
             }
-            for(int i = 0; i < length; ++i) {
+            for(int64_t i = 0; i < length; ++i) {
                 for(int j = 0; j < 3; ++j) {
                     MAC_res[i*3+j] = MAC[location[i*bucket_size]*3+j];
                     KEY_res[i*3+j] = KEY[location[i*bucket_size]*3+j];
                 }
-                for(int j = 1; j < bucket_size; ++j) {
+                for(int64_t j = 1; j < bucket_size; ++j) {
                     MAC_res[3*i] = MAC_res[3*i] ^ MAC[location[i*bucket_size+j]*3];
                     KEY_res[3*i] = KEY_res[3*i] ^ KEY[location[i*bucket_size+j]*3];
 
@@ -311,9 +308,9 @@ class Fpre {
         }
 
 //for debug
-        void check_correctness(block * MAC, block * KEY, int length) {
+        void check_correctness(block * MAC, block * KEY, int64_t length) {
             if (party == ALICE) {
-                for(int i = 0; i < length*3; ++i) {
+                for(int64_t i = 0; i < length*3; ++i) {
                     bool tmp = getLSB(MAC[i]);
                     io.send_data(&tmp, 1);
                 }
@@ -322,7 +319,7 @@ class Fpre {
                 block DD;
                 io.recv_block(&DD, 1);
 
-                for(int i = 0; i < length*3; ++i) {
+                for(int64_t i = 0; i < length*3; ++i) {
                     block tmp;
                     io.recv_block(&tmp, 1);
                     if(getLSB(MAC[i])) tmp = tmp ^ DD;
@@ -332,7 +329,7 @@ class Fpre {
 
             } else {
                 bool tmp[3];
-                for(int i = 0; i < length; ++i) {
+                for(int64_t i = 0; i < length; ++i) {
                     io.recv_data(tmp, 3);
                     bool res = ((tmp[0] != getLSB(MAC[3*i]) ) && (tmp[1] != getLSB(MAC[3*i+1])));
                     if(res != (tmp[2] != getLSB(MAC[3*i+2])) ) {
@@ -342,7 +339,7 @@ class Fpre {
                 block DD;
                 io.recv_block(&DD, 1);
 
-                for(int i = 0; i < length*3; ++i) {
+                for(int64_t i = 0; i < length*3; ++i) {
                     block tmp;
                     io.recv_block(&tmp, 1);
                     if(getLSB(MAC[i])) tmp = tmp ^ DD;
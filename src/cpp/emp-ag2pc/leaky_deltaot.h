@@ -13,15 +13,15 @@ class LeakyDeltaOT: public IKNP {
 public:
     LeakyDeltaOT(IOChannel io): IKNP(io) {}
 
-    void send_dot(block * data, int length) {
+    void send_dot(block * data, int64_t length) {
         this->send_cot(data, length);
         this->io.flush();
         block one = makeBlock(0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFE);
-        for (int i = 0; i < length; ++i) {
+        for (int64_t i = 0; i < length; ++i) {
             data[i] = data[i] & one;
         }
     }
-    void recv_dot(block* data, int length) {
+    void recv_dot(block* data, int64_t length) {
         bool * b = new bool[length];
         this->prg.random_bool(b, length);
         this->recv_cot(data, b, length);
@@ -31,7 +31,7 @@ public:
         ch[0] = zero_block;
         ch[1] = makeBlock(0, 1);
         block one = makeBlock(0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFE);
-        for (int i = 0; i < length; ++i) {
+        for (int64_t i = 0; i < length; ++i) {
             data[i] = (data[i] & one) ^ ch[b[i]];
         }
         delete[] b;
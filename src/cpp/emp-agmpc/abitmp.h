@@ -1,11 +1,10 @@
 #ifndef ABIT_MP_H
 #define ABIT_MP_H
 
-#include <optional>
-
 #include <emp-tool/emp-tool.h>
 #include <emp-ot/emp-ot.h>
 #include "netmp.h"
+#include "cmpc_config.h"
 #include "helper.h"
 #include "nvec.h"
 #include "vec.h"
@@ -13,14 +12,15 @@
 class ABitMP { public:
     std::shared_ptr<IMultiIO> io;
     int nP;
-    Vec<std::optional<IKNP>> abit1;
-    Vec<std::optional<IKNP>> abit2;
+    Vec<std::shared_ptr<IKNP>> abit1;
+    Vec<std::shared_ptr<IKNP>> abit2;
     int party;
     PRG prg;
     block Delta;
     Hash hash;
     int ssp;
     block * pretable;
+    std::shared_ptr<ThreadPool> pool;
 
     ABitMP(
         std::shared_ptr<IMultiIO>& io,
@@ -43,11 +43,19 @@ class ABitMP { public:
 
         for(int i = 1; i <= nP; ++i) for(int j = 1; j <= nP; ++j) if(i < j) {
             if(i == party) {
-                abit1[j].emplace(get_recv_channel(*io, j));
-                abit2[j].emplace(get_send_channel(*io, j));
+                abit1[j] = make_ot_extension(get_recv_channel(*io, j), io->ot_k(j));
+                abit2[j] = make_ot_extension(get_send_channel(*io, j), io->ot_k(j));
             } else if (j == party) {
-                abit2[i].emplace(get_send_channel(*io, i));
-                abit1[i].emplace(get_recv_channel(*io, i));
+                abit2[i] = make_ot_extension(get_send_channel(*io, i), io->ot_k(i));
+                abit1[i] = make_ot_extension(get_recv_channel(*io, i), io->ot_k(i));
+            }
+        }
+
+        if(fpre_threads > 1) {
+            pool = shared_thread_pool(fpre_threads);
+            for(int i = 1; i <= nP; ++i) if(i != party) {
+                abit1[i]->pool = pool.get();
+                abit2[i]->pool = pool.get();
             }
         }
 
@@ -73,21 +81,21 @@ class ABitMP { public:
             Delta = abit1[1]->Delta;
     }
 
-    void compute(NVec<block>& MAC, NVec<block>& KEY, bool* data, int length) {
+    void compute(NVec<block>& MAC, NVec<block>& KEY, bool* data, int64_t length) {
         for(int i = 1; i <= nP; ++i) for(int j = 1; j<= nP; ++j) if( (i < j) and (i == party or j == party) ) {
             int party2 = i + j - party;
 
             if (party < party2) {
-                abit2[party2]->recv_cot(&MAC.at(party2, 0), data, length);
+                abit2[party2]->recv_cot(MAC.row(party2), data, length);
                 io->flush(party2);
 
-                abit1[party2]->send_cot(&KEY.at(party2, 0), length);
+                abit1[party2]->send_cot(KEY.row(party2), length);
                 io->flush(party2);
             } else {
-                abit1[party2]->send_cot(&KEY.at(party2, 0), length);
+                abit1[party2]->send_cot(KEY.row(party2), length);
                 io->flush(party2);
 
-                abit2[party2]->recv_cot(&MAC.at(party2, 0), data, length);
+                abit2[party2]->recv_cot(MAC.row(party2), data, length);
                 io->flush(party2);
             }
         }
@@ -96,12 +104,12 @@ class ABitMP { public:
 #endif
     }
 
-    void check(const NVec<block>& MAC, const NVec<block>& KEY, bool* data, int length) {
+    void check(const NVec<block>& MAC, const NVec<block>& KEY, bool* data, int64_t length) {
         check1(MAC, KEY, data, length);
         check2(MAC, KEY, data, length);
     }
 
-    void check1(const NVec<block>& MAC, const NVec<block>& KEY, bool* data, int length) {
+    void check1(const NVec<block>& MAC, const NVec<block>& KEY, bool* data, int64_t length) {
         block seed = sampleRandom(nP, *io, &prg, party);
         PRG prg2(&seed);
         uint8_t * tmp;
@@ -113,7 +121,7 @@ class ABitMP { public:
 
         tmp = new uint8_t[ssp*length];
         prg2.random_data(tmp, ssp*length);
-        for(int i = 0; i < ssp*length; ++i)
+        for(int64_t i = 0; i < ssp*length; ++i)
             tmp[i] = tmp[i] % 4;
 //        for(int j = 0; j < ssp; ++j) {
 //            tmp[j] = new bool[length];
@@ -129,7 +137,7 @@ class ABitMP { public:
         memset(tMAC, 0, sizeof(block)*4*SIZE/chk);
         memset(tKEY, 0, sizeof(block)*4*SIZE/chk);
         memset(tb, false, 4*length/chk);
-        for(int i = 0; i < length; i+=chk) {
+        for(int64_t i = 0; i < length; i+=chk) {
             tb[i/chk][1] = data[i];
             tb[i/chk][2] = data[i+1];
             tb[i/chk][3] = data[i] != data[i+1];
@@ -137,20 +145,20 @@ class ABitMP { public:
 
         for(int k = 1; k <= nP; ++k) if(k != party) {
             uint8_t * tmpptr = tmp;
-            for(int tt = 0; tt < length/SIZE; tt++) {
-                int start = SIZE*tt;
-                for(int i = SIZE*tt; i < SIZE*(tt+1) and i < length; i+=chk) {
-                  tMAC[(i-start)/chk][1] = MAC.at(k, i);
-                  tMAC[(i-start)/chk][2] = MAC.at(k, i+1);
-                  tMAC[(i-start)/chk][3] = MAC.at(k, i) ^ MAC.at(k, i+1);
-
-                  tKEY[(i-start)/chk][1] = KEY.at(k, i);
-                  tKEY[(i-start)/chk][2] = KEY.at(k, i+1);
-                  tKEY[(i-start)/chk][3] = KEY.at(k, i) ^ KEY.at(k, i+1);
+            for(int64_t tt = 0; tt < length/SIZE; tt++) {
+                int64_t start = SIZE*tt;
+                for(int64_t i = SIZE*tt; i < SIZE*(tt+1) and i < length; i+=chk) {
+                  tMAC[(i-start)/chk][1] = MAC(k, i);
+                  tMAC[(i-start)/chk][2] = MAC(k, i+1);
+                  tMAC[(i-start)/chk][3] = MAC(k, i) ^ MAC(k, i+1);
+
+                  tKEY[(i-start)/chk][1] = KEY(k, i);
+                  tKEY[(i-start)/chk][2] = KEY(k, i+1);
+                  tKEY[(i-start)/chk][3] = KEY(k, i) ^ KEY(k, i+1);
                   for(int j = 0; j < ssp; ++j) {
-                             Ms.at(k, j) = Ms.at(k, j) ^ tMAC[(i-start)/chk][*tmpptr];
-                             Ks.at(k, j) = Ks.at(k, j) ^ tKEY[(i-start)/chk][*tmpptr];
-                             bs.at(k, j) = bs.at(k, j) != tb[i/chk][*tmpptr];
+                             Ms(k, j) = Ms(k, j) ^ tMAC[(i-start)/chk][*tmpptr];
+                             Ks(k, j) = Ks(k, j) ^ tKEY[(i-start)/chk][*tmpptr];
+                             bs(k, j) = bs(k, j) != tb[i/chk][*tmpptr];
                              ++tmpptr;
                     }
                 }
@@ -162,26 +170,26 @@ class ABitMP { public:
         for(int i = 1; i <= nP; ++i) for(int j = 1; j<= nP; ++j) if( (i < j) and (i == party or j == party) ) {
             int party2 = i + j - party;
 
-            get_send_channel(*io, party2).send_data(&Ms.at(party2, 0), sizeof(block)*ssp);
-            get_send_channel(*io, party2).send_data(&bs.at(party2, 0), ssp);
+            get_send_channel(*io, party2).send_data(Ms.row(party2), sizeof(block)*ssp);
+            get_send_channel(*io, party2).send_data(bs.row(party2), ssp);
             io->flush(party2);
             res.push_back(false);
 
-            get_recv_channel(*io, party2).recv_data(&tMs.at(party2, 0), sizeof(block)*ssp);
-            get_recv_channel(*io, party2).recv_data(&tbs.at(party2, 0), ssp);
+            get_recv_channel(*io, party2).recv_data(tMs.row(party2), sizeof(block)*ssp);
+            get_recv_channel(*io, party2).recv_data(tbs.row(party2), ssp);
             for(int k = 0; k < ssp; ++k) {
-                if(tbs.at(party2, k))
-                    Ks.at(party2, k) = Ks.at(party2, k) ^ Delta;
+                if(tbs(party2, k))
+                    Ks(party2, k) = Ks(party2, k) ^ Delta;
             }
-            res.push_back(!cmpBlock(&Ks.at(party2, 0), &tMs.at(party2, 0), ssp));
+            res.push_back(!cmpBlock(Ks.row(party2), tMs.row(party2), ssp));
         }
         if(checkCheat(res)) error("cheat check1\n");
     }
 
-    void check2(const NVec<block>& MAC, const NVec<block> KEY, bool* data, int length) {
+    void check2(const NVec<block>& MAC, const NVec<block> KEY, bool* data, int64_t length) {
         //last 2*ssp are garbage already.
         NVec<block> Ks(2, ssp);
-        NVec<block> Ms(nP+1, nP+1, ssp);
+        NVec<block, 3> Ms(nP+1, nP+1, ssp);
         NVec<block> KK(nP+1, ssp);
         NVec<bool> bs(nP+1, ssp);
 
@@ -190,18 +198,18 @@ class ABitMP { public:
         char (*dgst1)[Hash::DIGEST_SIZE] = new char[ssp*(nP+1)][Hash::DIGEST_SIZE];
 
         for(int i = 0; i < ssp; ++i) {
-            Ks.at(0, i) = zero_block;
+            Ks(0, i) = zero_block;
             for(int j = 1; j <= nP; ++j) if(j != party)
-                Ks.at(0, i) = Ks.at(0, i) ^ KEY.at(j, length-3*ssp+i);
+                Ks(0, i) = Ks(0, i) ^ KEY(j, length-3*ssp+i);
 
-            Ks.at(1, i) = Ks.at(0, i) ^ Delta;
-            Hash::hash_once(dgst0[party*ssp+i], &Ks.at(0, i), sizeof(block));
-            Hash::hash_once(dgst1[party*ssp+i], &Ks.at(1, i), sizeof(block));
+            Ks(1, i) = Ks(0, i) ^ Delta;
+            Hash::hash_once(dgst0[party*ssp+i], &Ks(0, i), sizeof(block));
+            Hash::hash_once(dgst1[party*ssp+i], &Ks(1, i), sizeof(block));
         }
         Hash h;
         h.put(data+length-3*ssp, ssp);
         for(int j = 1; j <= nP; ++j) if(j != party) {
-            h.put(&MAC.at(j, length-3*ssp), ssp*sizeof(block));
+            h.put(&MAC(j, length-3*ssp), ssp*sizeof(block));
         }
         h.digest(dgst[party]);
 
@@ -217,42 +225,42 @@ class ABitMP { public:
 
         vector<bool> res2;
         for(int k = 1; k <= nP; ++k) if(k!= party)
-            memcpy(&Ms.at(party, k, 0), &MAC.at(k, length-3*ssp), sizeof(block)*ssp);
+            memcpy(Ms.row(party, k), &MAC(k, length-3*ssp), sizeof(block)*ssp);
 
         for(int i = 1; i <= nP; ++i) for(int j = 1; j<= nP; ++j) if( (i < j) and (i == party or j == party) ) {
             int party2 = i + j - party;
 
             get_send_channel(*io, party2).send_data(data + length - 3*ssp, ssp);
             for(int k = 1; k <= nP; ++k) if(k != party)
-                get_send_channel(*io, party2).send_data(&MAC.at(k, length - 3*ssp), sizeof(block)*ssp);
+                get_send_channel(*io, party2).send_data(&MAC(k, length - 3*ssp), sizeof(block)*ssp);
             res2.push_back(false);
 
             Hash h;
-            get_recv_channel(*io, party2).recv_data(&bs.at(party2, 0), ssp);
-            h.put(&bs.at(party2, 0), ssp);
+            get_recv_channel(*io, party2).recv_data(bs.row(party2), ssp);
+            h.put(bs.row(party2), ssp);
             for(int k = 1; k <= nP; ++k) if(k != party2) {
-                get_recv_channel(*io, party2).recv_data(&Ms.at(party2, k, 0), sizeof(block)*ssp);
-                h.put(&Ms.at(party2, k, 0), sizeof(block)*ssp);
+                get_recv_channel(*io, party2).recv_data(Ms.row(party2, k), sizeof(block)*ssp);
+                h.put(Ms.row(party2, k), sizeof(block)*ssp);
             }
             char tmp[Hash::DIGEST_SIZE];h.digest(tmp);
             res2.push_back(strncmp(tmp, dgst[party2], Hash::DIGEST_SIZE) != 0);
         }
         if(checkCheat(res2)) error("commitment 1\n");
 
-        memset(&bs.at(party, 0), false, ssp);
+        memset(bs.row(party), false, ssp);
         for(int i = 1; i <= nP; ++i) if(i != party) {
             for(int j = 0; j < ssp; ++j)
-                bs.at(party, j) = bs.at(party, j) != bs.at(i, j);
+                bs(party, j) = bs(party, j) != bs(i, j);
         }
         for(int i = 1; i <= nP; ++i) for(int j = 1; j<= nP; ++j) if( (i < j) and (i == party or j == party) ) {
             int party2 = i + j - party;
 
-            get_send_channel(*io, party2).send_data(&bs.at(party, 0), ssp);
+            get_send_channel(*io, party2).send_data(bs.row(party), ssp);
             for(int i = 0; i < ssp; ++i) {
-                if (bs.at(party, i))
-                    get_send_channel(*io, party2).send_data(&Ks.at(1, i), sizeof(block));
+                if (bs(party, i))
+                    get_send_channel(*io, party2).send_data(&Ks(1, i), sizeof(block));
                 else
-                    get_send_channel(*io, party2).send_data(&Ks.at(0, i), sizeof(block));
+                    get_send_channel(*io, party2).send_data(&Ks(0, i), sizeof(block));
             }
             io->flush(party2);
             res2.push_back(false);
@@ -260,10 +268,10 @@ class ABitMP { public:
             bool cheat = false;
             bool *tmp_bool = new bool[ssp];
             get_recv_channel(*io, party2).recv_data(tmp_bool, ssp);
-            get_recv_channel(*io, party2).recv_data(&KK.at(party2, 0), ssp*sizeof(block));
+            get_recv_channel(*io, party2).recv_data(KK.row(party2), ssp*sizeof(block));
             for(int i = 0; i < ssp; ++i) {
                 char tmp[Hash::DIGEST_SIZE];
-                Hash::hash_once(tmp, &KK.at(party2, i), sizeof(block));
+                Hash::hash_once(tmp, &KK(party2, i), sizeof(block));
                 if(tmp_bool[i])
                     cheat = cheat or (strncmp(tmp, dgst1[party2*ssp+i], Hash::DIGEST_SIZE)!=0);
                 else
@@ -280,9 +288,9 @@ class ABitMP { public:
             memset(tmp_block, 0, sizeof(block)*ssp);
             for(int j = 1; j <= nP; ++j) if(j != i) {
                 for(int k = 0; k < ssp; ++k)
-                    tmp_block[k] = tmp_block[k] ^ Ms.at(j, i, k);
+                    tmp_block[k] = tmp_block[k] ^ Ms(j, i, k);
             }
-            cheat = cheat or !cmpBlock(tmp_block, &KK.at(i, 0), ssp);
+            cheat = cheat or !cmpBlock(tmp_block, KK.row(i), ssp);
         }
         if(cheat) error("cheat aShare\n");
 
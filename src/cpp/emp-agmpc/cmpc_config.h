@@ -1,7 +1,13 @@
 #ifndef CMPC_CONFIG
 #define CMPC_CONFIG
+#include "emp-tool/utils/thread_pool.h"
 const static int abit_block_size = 1024;
-const static int fpre_threads = 1;
+// threads used by the OT extension in ABitMP, 1 keeps it on the calling thread
+const static int fpre_threads = EMP_THREADS;
+// AND gates of one circuit level hashed together by the CMPC evaluator
+const static int online_and_batch = 128;
+// threads party 1 evaluates each circuit level with, 1 keeps it on the calling thread
+const static int online_threads = EMP_THREADS;
 #define LOCALHOST
 
 #ifdef __clang__
@@ -2,6 +2,7 @@
 #define EMP_AGMPC_FLEXIBLE_INPUT_OUTPUT_H
 
 #include "vec.h"
+#include <emp-tool/utils/packed_bits.h>
 
 using namespace std;
 
@@ -52,10 +53,11 @@ public:
 
     bool cmpc_associated = false;
     bool *value;
-    NVec<block>* key;
-    NVec<block>* mac;
+    NVec<block>* key; // dim: wires, parties
+    NVec<block>* mac; // dim: wires, parties
     IMultiIO* io;
     block Delta;
+    bool semi_honest = false; // openings go without MACs
 
     vector<int> party_assignment;
     // -2 represents an un-authenticated share (e.g., for random tape),
@@ -63,7 +65,12 @@ public:
     //  0 represents public input/output,
 
     vector<bool> plaintext_assignment; // if `party` provides the value for this bit, the plaintext value is here
-    vector<AuthBitShare> authenticated_share_assignment; // if this bit is from authenticated shares, the authenticated share is stored here
+
+    // if this bit is from authenticated shares, the authenticated share is
+    // stored here, only allocated once one is assigned
+    Vec<bool> authenticated_bit_share; // dim: len
+    NVec<block> authenticated_key; // dim: len, parties
+    NVec<block> authenticated_mac; // dim: len, parties
 
     FlexIn(int nP, int len, int party) {
         this->nP = nP;
@@ -72,13 +79,6 @@ public:
 
         party_assignment.resize(len, 0);
         plaintext_assignment.resize(len, false);
-        authenticated_share_assignment.resize(len, AuthBitShare(nP));
-    }
-
-    ~FlexIn() {
-        party_assignment.clear();
-        plaintext_assignment.clear();
-        authenticated_share_assignment.clear();
     }
 
     void associate_cmpc(
@@ -86,7 +86,8 @@ public:
         NVec<block>& associated_mac,
         NVec<block>& associated_key,
         std::shared_ptr<IMultiIO>& associated_io,
-        block associated_Delta
+        block associated_Delta,
+        bool associated_semi_honest = false
     ) {
         this->cmpc_associated = true;
         this->value = associated_value;
@@ -94,6 +95,7 @@ public:
         this->key = &associated_key;
         this->io = &*associated_io;
         this->Delta = associated_Delta;
+        this->semi_honest = associated_semi_honest;
     }
 
     void assign_party(int pos, int which_party) {
@@ -105,417 +107,203 @@ public:
         plaintext_assignment[pos] = cur_bit;
     }
 
+    // assign_party for the len bits from pos
+    void assign_party(int pos, int len, int which_party) {
+        assert(pos >= 0 && len >= 0 && pos + len <= this->len);
+        std::fill(party_assignment.begin() + pos, party_assignment.begin() + pos + len, which_party);
+    }
+
+    // assign_plaintext_bit for the bits.size() bits from pos, packed
+    void assign_plaintext_bits(int pos, PackedBitsView bits) {
+        assert(pos + bits.size() <= size_t(len));
+        for(size_t i = 0; i < bits.size(); ++i) {
+            assert(party_assignment[pos + i] == party || party_assignment[pos + i] == -2  || party_assignment[pos + i] == 0);
+            plaintext_assignment[pos + i] = bits[i];
+        }
+    }
+
     void assign_authenticated_bitshare(int pos, AuthBitShare *abit) {
         assert(party_assignment[pos] == -1);
-        authenticated_share_assignment[pos] = *abit;
+        if(authenticated_bit_share.empty()) {
+            authenticated_bit_share.resize(len);
+            authenticated_key.resize(len, nP + 1);
+            authenticated_mac.resize(len, nP + 1);
+        }
+        authenticated_bit_share[pos] = abit->bit_share;
+        for(int j = 1; j <= nP; j++) {
+            authenticated_key(pos, j) = abit->key[j];
+            authenticated_mac(pos, j) = abit->mac[j];
+        }
     }
 
     void input(bool *masked_input_ret) {
         assert(cmpc_associated);
 
-        /* assemble an array of the input masks, their macs, and their keys */
         /*
-         * Then,
+         * The input masks are the associated shares of the first len wires.
+         *
          *         for a plaintext bit, the input mask, as well as its MAC, is sent to the input party, who uses the KEY for verification;
          *         for an un-authenticated bit, the input mask XOR with the input share is broadcast;
          *        for an authenticated bit share, they are used to masked the previously data (and then checking its opening)
+         *         for a public bit, the input mask and its MAC are broadcast.
+         *
+         * party_assignment is known to every party, so only the bits each
+         * recipient needs go on the wire, packed, with one 16 byte MAC per
+         * authenticated bit. All of the openings to one peer share a
+         * single message, followed by one more with the masked plaintext
+         * inputs of the input party.
          */
-        vector<AuthBitShare> input_mask;
+        vector<vector<int>> owned(nP + 1); // party_assignment[] > 0
+        vector<int> authenticated;          // party_assignment[] == -1
+        vector<int> unauthenticated;        // party_assignment[] == -2
+        vector<int> pub;                    // party_assignment[] == 0
         for(int i = 0; i < len; i++) {
-            AuthBitShare abit(nP);
-            abit.bit_share = value[i];
-            for(int j = 1; j <= nP; j++) {
-                if(j != party) {
-                    abit.key[j] = key->at(j, i);
-                    abit.mac[j] = mac->at(j, i);
-                }
-            }
-            input_mask.emplace_back(abit);
-        }
-
-        /*
-         * first of all, handle the case party_assignment[] > 0
-         */
-
-        /* prepare the bit shares to open for the corresponding party */
-        vector<vector<BitWithMac>> open_bit_shares_for_plaintext_input_send;
-        open_bit_shares_for_plaintext_input_send.resize(nP + 1);
+            if(party_assignment[i] > 0)
+                owned[party_assignment[i]].push_back(i);
+            else if(party_assignment[i] == -1)
+                authenticated.push_back(i);
+            else if(party_assignment[i] == -2)
+                unauthenticated.push_back(i);
+            else
+                pub.push_back(i);
+        }
+        assert(authenticated.empty() or !authenticated_bit_share.empty());
+
+        const vector<int>& mine = owned[party];
+        size_t shared_bits = authenticated.size() + unauthenticated.size() + pub.size();
+        size_t shared_macs = authenticated.size() + pub.size();
+        size_t max_owned = 0;
+        for(int j = 1; j <= nP; j++)
+            max_owned = std::max(max_owned, owned[j].size());
+
+        /* the openings received from each peer: mine, authenticated, unauthenticated, public */
+        NVec<bool> recv_bits_from(nP + 1, mine.size() + shared_bits);
+        NVec<block> recv_macs_from(nP + 1, semi_honest ? 0 : mine.size() + shared_macs);
+
+        Vec<bool> send_bits_buf(max_owned + shared_bits);
+        Vec<block> send_macs_buf(max_owned + shared_macs);
 
-        for(int j = 1; j <= nP; j++) {
-            if(j != party) {
-                for(int i = 0; i < len; i++) {
-                    BitWithMac mbit{};
-                    if(party_assignment[i] == j) {
-                        mbit.bit_share = input_mask[i].bit_share;
-                        mbit.mac = input_mask[i].mac[j];
-                    }
-                    open_bit_shares_for_plaintext_input_send[j].push_back(mbit);
-                }
-            }
-        }
-
-        vector<vector<BitWithMac>> open_bit_shares_for_plaintext_input_recv;
-        open_bit_shares_for_plaintext_input_recv.resize(nP + 1);
-        for(int j = 1; j <= nP; j++) {
-            open_bit_shares_for_plaintext_input_recv[j].resize(len);
-        }
-
-        /*
-         * exchange the opening of the input mask
-         */
         for (int i = 1; i <= nP; ++i) {
             for (int j = 1; j <= nP; ++j) {
                 if ((i < j) and (i == party or j == party)) {
                     int party2 = i + j - party;
 
-                    get_send_channel(*io, party2).send_data(open_bit_shares_for_plaintext_input_send[party2].data(), sizeof(BitWithMac) * len);
-                    io->flush(party2);
-                    get_recv_channel(*io, party2).recv_data(open_bit_shares_for_plaintext_input_recv[party2].data(), sizeof(BitWithMac) * len);
-                    io->flush(party2);
-                }
-            }
-        }
-
-        /*
-         * verify the input mask
-         */
-        vector<bool> res_check;
-        for (int j = 1; j <= nP; ++j) {
-            if(j != party) {
-                bool check = false;
-                for (int i = 0; i < len; i++) {
-                    if (party_assignment[i] == party) {
-                        block supposed_mac = Delta & select_mask[open_bit_shares_for_plaintext_input_recv[j][i].bit_share? 1 : 0];
-                        supposed_mac ^= input_mask[i].key[j];
-
-                        block provided_mac = open_bit_shares_for_plaintext_input_recv[j][i].mac;
-
-                        if(!cmpBlock(&supposed_mac, &provided_mac, 1)) {
-                            check = true;
-                            break;
-                        }
+                    size_t nb = 0, nm = 0;
+                    for(int w : owned[party2]) {
+                        send_bits_buf[nb++] = value[w];
+                        send_macs_buf[nm++] = (*mac)(w, party2);
                     }
-                }
-                res_check.push_back(check);
-            }
-        }
-        if(checkCheat(res_check)) error("cheat in FlexIn's plaintext input mask!");
-
-        /*
-         * broadcast the masked input
-         */
-        vector<char> masked_input_sent;    // use char instead of bool because bools seem to fail for "data()"
-        vector<vector<char>> masked_input_recv;
-        masked_input_sent.resize(len);
-        masked_input_recv.resize(nP + 1);
-        for(int j = 1; j <= nP; j++) {
-            masked_input_recv[j].resize(len);
-        }
-
-        for(int i = 0; i < len; i++) {
-            if(party_assignment[i] == party) {
-                masked_input_sent[i] = plaintext_assignment[i] ^ input_mask[i].bit_share;
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        masked_input_sent[i] = masked_input_sent[i] ^ open_bit_shares_for_plaintext_input_recv[j][i].bit_share;
+                    for(int w : authenticated) {
+                        send_bits_buf[nb++] = authenticated_bit_share[w] != value[w];
+                        send_macs_buf[nm++] = authenticated_mac(w, party2) ^ (*mac)(w, party2);
                     }
-                }
-            }
-        }
-
-        for (int i = 1; i <= nP; ++i) {
-            for (int j = 1; j <= nP; ++j) {
-                if ((i < j) and (i == party or j == party)) {
-                    int party2 = i + j - party;
-
-                    get_send_channel(*io, party2).send_data(masked_input_sent.data(), sizeof(char) * len);
-                    io->flush(party2);
-                    get_recv_channel(*io, party2).recv_data(masked_input_recv[party2].data(), sizeof(char) * len);
-                    io->flush(party2);
-                }
-            }
-        }
-
-        vector<bool> masked_input;
-        masked_input.resize(len);
-        for(int i = 0; i < len; i++) {
-            if(party_assignment[i] > 0) {
-                int this_party = party_assignment[i];
-                if(this_party == party) {
-                    masked_input[i] = masked_input_sent[i];
-                } else {
-                    masked_input[i] = masked_input_recv[this_party][i];
-                }
-            }
-        }
-
-        /*
-         * secondly, handle the case party_assignment[] == -1
-         */
-
-        /*
-         * Compute the authenticated bit share to the new circuit
-         * by XOR-ing with the input mask
-         */
-        vector<AuthBitShare> authenticated_bitshares_new_circuit;
-        for(int i = 0; i < len; i++) {
-            AuthBitShare new_entry(nP);
-            if(party_assignment[i] == -1) {
-                new_entry.bit_share = authenticated_share_assignment[i].bit_share ^ input_mask[i].bit_share;
-                for (int j = 1; j <= nP; j++) {
-                    new_entry.key[j] = authenticated_share_assignment[i].key[j] ^ input_mask[i].key[j];
-                    new_entry.mac[j] = authenticated_share_assignment[i].mac[j] ^ input_mask[i].mac[j];
-                }
-            }
-            authenticated_bitshares_new_circuit.emplace_back(new_entry);
-        }
-
-        //print_block(Delta);
-
-        /*
-        cout << "Debug the authenticated input" << endl;
-        for(int i = 0; i < 10; i++){
-            if(party_assignment[i] == -1) {
-                cout << "index: " << i << ", value: " << authenticated_share_assignment[i].bit_share << endl;
-                cout << "mac: " << endl;
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        //cout << j << ": ";
-                        print_block(authenticated_share_assignment[i].mac[j]);
+                    for(int w : unauthenticated)
+                        send_bits_buf[nb++] = plaintext_assignment[w] != value[w];
+                    for(int w : pub) {
+                        send_bits_buf[nb++] = value[w];
+                        send_macs_buf[nm++] = (*mac)(w, party2);
                     }
-                }
-                cout << "key: " << endl;
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        //cout << j << ": ";
-                        print_block(authenticated_share_assignment[i].key[j]);
-                        print_block(authenticated_share_assignment[i].key[j] ^ Delta);
-                    }
-                }
-                cout << "=============" << endl;
-            }
-        }
-         */
 
-        /*
-         * Opening the authenticated shares
-         */
-        vector<vector<BitWithMac>> open_bit_shares_for_authenticated_bits_send;
-        open_bit_shares_for_authenticated_bits_send.resize(nP + 1);
-
-        for(int j = 1; j <= nP; j++) {
-            if(j != party) {
-                for(int i = 0; i < len; i++) {
-                    BitWithMac mbit{};
-                    if(party_assignment[i] == -1) {
-                        mbit.bit_share = authenticated_bitshares_new_circuit[i].bit_share;
-                        mbit.mac = authenticated_bitshares_new_circuit[i].mac[j];
-                    }
-                    open_bit_shares_for_authenticated_bits_send[j].push_back(mbit);
-                }
-            }
-        }
-
-        vector<vector<BitWithMac>> open_bit_shares_for_authenticated_bits_recv;
-        open_bit_shares_for_authenticated_bits_recv.resize(nP + 1);
-        for(int j = 1; j <= nP; j++) {
-            open_bit_shares_for_authenticated_bits_recv[j].resize(len);
-        }
-
-        for (int i = 1; i <= nP; ++i) {
-            for (int j = 1; j <= nP; ++j) {
-                if ((i < j) and (i == party or j == party)) {
-                    int party2 = i + j - party;
-
-                    get_send_channel(*io, party2).send_data(open_bit_shares_for_authenticated_bits_send[party2].data(), sizeof(BitWithMac) * len);
-                    io->flush(party2);
-                    get_recv_channel(*io, party2).recv_data(open_bit_shares_for_authenticated_bits_recv[party2].data(), sizeof(BitWithMac) * len);
+                    send_bits(get_send_channel(*io, party2), send_bits_buf.begin(), nb);
+                    if(!semi_honest)
+                        get_send_channel(*io, party2).send_data(send_macs_buf.begin(), nm * sizeof(block));
                     io->flush(party2);
+                    recv_bits(get_recv_channel(*io, party2), recv_bits_from.row(party2), mine.size() + shared_bits);
+                    if(!semi_honest)
+                        get_recv_channel(*io, party2).recv_data(recv_macs_from.row(party2), (mine.size() + shared_macs) * sizeof(block));
                 }
             }
         }
 
         /*
-         * verify the input mask shares
+         * verify the openings
          */
+        vector<bool> res_plaintext, res_authenticated, res_public;
         for (int j = 1; j <= nP; ++j) {
-            if(j != party) {
+            if(j != party and !semi_honest) {
+                const bool *bits = recv_bits_from.row(j);
+                const block *macs = recv_macs_from.row(j);
                 bool check = false;
-                for (int i = 0; i < len; i++) {
-                    if (party_assignment[i] == -1) {
-                        block supposed_mac = Delta & select_mask[open_bit_shares_for_authenticated_bits_recv[j][i].bit_share? 1 : 0];
-                        supposed_mac ^= authenticated_bitshares_new_circuit[i].key[j];
-
-                        block provided_mac = open_bit_shares_for_authenticated_bits_recv[j][i].mac;
 
-                        if(!cmpBlock(&supposed_mac, &provided_mac, 1)) {
-                            check = true;
-                            break;
-                        }
-                    }
+                for(size_t k = 0; k < mine.size(); ++k, ++bits, ++macs) {
+                    block supposed_mac = (*key)(mine[k], j) ^ (Delta & select_mask[*bits ? 1 : 0]);
+                    check = check or !cmpBlock(&supposed_mac, macs, 1);
                 }
-                res_check.push_back(check);
-            }
-        }
-        if(checkCheat(res_check)) error("cheat in FlexIn's authenticated share input mask!");
-
-        /*
-         * Reconstruct the authenticated shares
-         */
-        for(int i = 0; i < len; i++) {
-            if(party_assignment[i] == -1) {
-                masked_input[i] = authenticated_bitshares_new_circuit[i].bit_share;
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        masked_input[i] = masked_input[i] ^ open_bit_shares_for_authenticated_bits_recv[j][i].bit_share;
-                    }
+                res_plaintext.push_back(check);
+
+                check = false;
+                for(int w : authenticated) {
+                    block supposed_mac = authenticated_key(w, j) ^ (*key)(w, j) ^ (Delta & select_mask[*bits ? 1 : 0]);
+                    check = check or !cmpBlock(&supposed_mac, macs, 1);
+                    ++bits;
+                    ++macs;
                 }
-            }
-        }
+                res_authenticated.push_back(check);
 
-        /*
-         * thirdly, handle the case party_assignment[] = -2
-         */
+                bits += unauthenticated.size();
 
-        /*
-         * Collect the masked input shares for un-authenticated bits
-         */
-        vector<char> open_bit_shares_for_unauthenticated_bits_send;
-        open_bit_shares_for_unauthenticated_bits_send.resize(len);
-
-        for(int i = 0; i < len; i++) {
-            if(party_assignment[i] == -2) {
-                open_bit_shares_for_unauthenticated_bits_send[i] = (plaintext_assignment[i] ^ input_mask[i].bit_share)? 1 : 0;
-            }
-        }
-
-        vector<vector<char>> open_bit_shares_for_unauthenticated_bits_recv;
-        open_bit_shares_for_unauthenticated_bits_recv.resize(nP + 1);
-        for(int j = 1; j <= nP; j++) {
-            open_bit_shares_for_unauthenticated_bits_recv[j].resize(len);
-        }
-
-        for (int i = 1; i <= nP; ++i) {
-            for (int j = 1; j <= nP; ++j) {
-                if ((i < j) and (i == party or j == party)) {
-                    int party2 = i + j - party;
-
-                    get_send_channel(*io, party2).send_data(open_bit_shares_for_unauthenticated_bits_send.data(), sizeof(char) * len);
-                    io->flush(party2);
-                    get_recv_channel(*io, party2).recv_data(open_bit_shares_for_unauthenticated_bits_recv[party2].data(), sizeof(char) * len);
-                    io->flush(party2);
-                }
-            }
-        }
-
-        /*
-         * update the array of masked_input accordingly
-         */
-        for(int i = 0; i < len; i++) {
-            if(party_assignment[i] == -2) {
-                masked_input[i] = open_bit_shares_for_unauthenticated_bits_send[i];
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        masked_input[i] = masked_input[i] ^ (open_bit_shares_for_unauthenticated_bits_recv[j][i] == 1);
-                    }
+                check = false;
+                for(int w : pub) {
+                    block supposed_mac = (*key)(w, j) ^ (Delta & select_mask[*bits ? 1 : 0]);
+                    check = check or !cmpBlock(&supposed_mac, macs, 1);
+                    ++bits;
+                    ++macs;
                 }
+                res_public.push_back(check);
             }
         }
+        if(checkCheat(res_plaintext)) error("cheat in FlexIn's plaintext input mask!");
+        if(checkCheat(res_authenticated)) error("cheat in FlexIn's authenticated share input mask!");
+        if(checkCheat(res_public)) error("cheat in FlexIn's public input mask!");
 
         /*
-         * lastly, handle the case party_assignment[] = 0
+         * reconstruct everything but the plaintext inputs
          */
+        for(size_t k = 0; k < authenticated.size(); ++k)
+            masked_input_ret[authenticated[k]] = authenticated_bit_share[authenticated[k]] != value[authenticated[k]];
+        for(size_t k = 0; k < unauthenticated.size(); ++k)
+            masked_input_ret[unauthenticated[k]] = plaintext_assignment[unauthenticated[k]] != value[unauthenticated[k]];
+        for(size_t k = 0; k < pub.size(); ++k)
+            masked_input_ret[pub[k]] = plaintext_assignment[pub[k]] != value[pub[k]];
 
-        /*
-         * broadcast the input mask and its MAC
-         */
-        vector<vector<BitWithMac>> open_bit_shares_for_public_input_send;
-        open_bit_shares_for_public_input_send.resize(nP + 1);
+        Vec<bool> masked_mine(mine.size());
+        for(size_t k = 0; k < mine.size(); ++k)
+            masked_mine[k] = plaintext_assignment[mine[k]] != value[mine[k]];
 
-        for(int j = 1; j <= nP; j++) {
+        for (int j = 1; j <= nP; ++j) {
             if(j != party) {
-                for(int i = 0; i < len; i++) {
-                    BitWithMac mbit{};
-                    if(party_assignment[i] == 0) {
-                        mbit.bit_share = input_mask[i].bit_share;
-                        mbit.mac = input_mask[i].mac[j];
-                    }
-                    open_bit_shares_for_public_input_send[j].push_back(mbit);
-                }
+                const bool *bits = recv_bits_from.row(j);
+                for(size_t k = 0; k < mine.size(); ++k)
+                    masked_mine[k] = masked_mine[k] != *bits++;
+                for(int w : authenticated)
+                    masked_input_ret[w] = masked_input_ret[w] != *bits++;
+                for(int w : unauthenticated)
+                    masked_input_ret[w] = masked_input_ret[w] != *bits++;
+                for(int w : pub)
+                    masked_input_ret[w] = masked_input_ret[w] != *bits++;
             }
         }
 
-        vector<vector<BitWithMac>> open_bit_shares_for_public_input_recv;
-        open_bit_shares_for_public_input_recv.resize(nP + 1);
-        for(int j = 1; j <= nP; j++) {
-            open_bit_shares_for_public_input_recv[j].resize(len);
-        }
-
         /*
-         * exchange the opening of the input mask
+         * broadcast the masked plaintext input
          */
+        for(size_t k = 0; k < mine.size(); ++k)
+            masked_input_ret[mine[k]] = masked_mine[k];
+
+        Vec<bool> recv_masked(max_owned);
         for (int i = 1; i <= nP; ++i) {
             for (int j = 1; j <= nP; ++j) {
                 if ((i < j) and (i == party or j == party)) {
                     int party2 = i + j - party;
 
-                    get_send_channel(*io, party2).send_data(open_bit_shares_for_public_input_send[party2].data(), sizeof(BitWithMac) * len);
-                    io->flush(party2);
-                    get_recv_channel(*io, party2).recv_data(open_bit_shares_for_public_input_recv[party2].data(), sizeof(BitWithMac) * len);
+                    send_bits(get_send_channel(*io, party2), masked_mine.begin(), mine.size());
                     io->flush(party2);
+                    recv_bits(get_recv_channel(*io, party2), recv_masked.begin(), owned[party2].size());
+                    for(size_t k = 0; k < owned[party2].size(); ++k)
+                        masked_input_ret[owned[party2][k]] = recv_masked[k];
                 }
             }
         }
-
-        /*
-         * verify the input mask
-         */
-        for (int j = 1; j <= nP; ++j) {
-            if(j != party) {
-                bool check = false;
-                for (int i = 0; i < len; i++) {
-                    if (party_assignment[i] == 0) {
-                        block supposed_mac = Delta & select_mask[open_bit_shares_for_public_input_recv[j][i].bit_share? 1 : 0];
-                        supposed_mac ^= input_mask[i].key[j];
-
-                        block provided_mac = open_bit_shares_for_public_input_recv[j][i].mac;
-
-                        if(!cmpBlock(&supposed_mac, &provided_mac, 1)) {
-                            check = true;
-                            break;
-                        }
-                    }
-                }
-                res_check.push_back(check);
-            }
-        }
-        if(checkCheat(res_check)) error("cheat in FlexIn's public input mask!");
-
-        /*
-         * update the masked input
-         */
-        for(int i = 0; i < len; i++) {
-            if(party_assignment[i] == 0) {
-                masked_input[i] = plaintext_assignment[i] ^ input_mask[i].bit_share;
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        masked_input[i] = masked_input[i] ^ open_bit_shares_for_public_input_recv[j][i].bit_share;
-                    }
-                }
-            }
-        }
-
-        /*
-         cout << "masked_input" << endl;
-        for(int i = 0; i < len; i++) {
-            cout << masked_input[i] << " ";
-        }
-        cout << endl;
-         */
-
-        for(int i = 0; i < len; i++) {
-            masked_input_ret[i] = masked_input[i];
-        }
     }
 
     int get_length() {
@@ -534,36 +322,33 @@ public:
 
     bool cmpc_associated = false;
     bool *value;
-    NVec<block>* key;
-    NVec<block>* mac;
-    NVec<block>* eval_labels;
+    NVec<block>* key; // dim: wires, parties
+    NVec<block>* mac; // dim: wires, parties
+    NVec<block>* eval_labels; // dim: wires, parties
     IMultiIO* io;
     block Delta;
     block *labels;
+    bool semi_honest = false; // mask shares go without the hash of their MACs
 
     vector<int> party_assignment;
     // -1 represents an authenticated share,
     //  0 represents public output
 
     vector<bool> plaintext_results; // if `party` provides the value for this bit, the plaintext value is here
-    vector<AuthBitShare> authenticated_share_results; // if this bit is from authenticated shares, the authenticated share is stored here
+
+    // if this bit is from authenticated shares, the authenticated share is
+    // stored here, only allocated if any output is assigned -1
+    Vec<bool> authenticated_bit_share; // dim: len
+    NVec<block> authenticated_key; // dim: len, parties
+    NVec<block> authenticated_mac; // dim: len, parties
 
     FlexOut(int nP, int len, int party) {
         this->nP = nP;
         this->len = len;
         this->party = party;
 
-        AuthBitShare empty_abit(nP);
-
         party_assignment.resize(len, 0);
         plaintext_results.resize(len, false);
-        authenticated_share_results.resize(len, empty_abit);
-    }
-
-    ~FlexOut() {
-        party_assignment.clear();
-        plaintext_results.clear();
-        authenticated_share_results.clear();
     }
 
     void associate_cmpc(
@@ -573,7 +358,8 @@ public:
         NVec<block>& associated_eval_labels,
         Vec<block>& associated_labels,
         std::shared_ptr<IMultiIO>& associated_io,
-        block associated_Delta
+        block associated_Delta,
+        bool associated_semi_honest = false
     ) {
         this->cmpc_associated = true;
         this->value = associated_value;
@@ -585,6 +371,7 @@ public:
         }
         this->io = &*associated_io;
         this->Delta = associated_Delta;
+        this->semi_honest = associated_semi_honest;
     }
 
     void assign_party(int pos, int which_party) {
@@ -596,6 +383,30 @@ public:
         return plaintext_results[pos];
     }
 
+    // assign_party for the len bits from pos
+    void assign_party(int pos, int len, int which_party) {
+        assert(pos >= 0 && len >= 0 && pos + len <= this->len);
+        std::fill(party_assignment.begin() + pos, party_assignment.begin() + pos + len, which_party);
+    }
+
+    // get_plaintext_bit for the bits.size() bits from pos, packed into bits
+    void get_plaintext_bits(int pos, PackedBits bits) {
+        assert(pos + bits.size() <= size_t(len));
+        for(size_t i = 0; i < bits.size(); ++i) {
+            assert(party_assignment[pos + i] == party || party_assignment[pos + i] == 0);
+            bits.set(i, plaintext_results[pos + i]);
+        }
+    }
+
+    void get_authenticated_bitshare(int pos, AuthBitShare *abit) {
+        assert(party_assignment[pos] == -1);
+        abit->bit_share = authenticated_bit_share[pos];
+        for(int j = 1; j <= nP; j++) {
+            abit->key[j] = authenticated_key(pos, j);
+            abit->mac[j] = authenticated_mac(pos, j);
+        }
+    }
+
     int get_length() {
         return len;
     }
@@ -604,203 +415,164 @@ public:
         assert(cmpc_associated);
 
         /*
-         * Party 1 sends the labels of all the output wires out.
-         */
-        vector<block> output_wire_label_recv;
-        output_wire_label_recv.resize(len);
-
-        if(party == ALICE) {
-            vector<vector<block>> output_wire_label_send;
-            output_wire_label_send.resize(nP + 1);
-
-            for (int j = 2; j <= nP; j++) {
-                output_wire_label_send[j].resize(len);
-                for(int i = 0; i < len; i++) {
-                    output_wire_label_send[j][i] = eval_labels->at(j, output_shift + i);
-                }
-            }
-
-            for(int j = 2; j <= nP; j++) {
-                get_send_channel(*io, j).send_data(output_wire_label_send[j].data(), sizeof(block) * len);
-                io->flush(j);
-            }
-        }else {
-            get_recv_channel(*io, ALICE).recv_data(output_wire_label_recv.data(), sizeof(block) * len);
-            io->flush(ALICE);
-        }
-
-        /*
-         * Each party extracts x ^ r of each output wire
+         * party_assignment is known to every party, so each peer is only
+         * sent what it needs:
+         *
+         *         party 1 sends the labels of the output wires the peer learns (its own, public) or gets a share of (authenticated);
+         *         every party sends its packed shares of the output masks the peer learns, with one hash of the matching MACs.
+         *
+         * Both go out in a single exchange.
          */
-        vector<bool> masked_output;
-        masked_output.resize(len);
-
-        if(party == ALICE) {
-            for(int i = 0; i < len; i++) {
-                masked_output[i] = masked_input_ret[output_shift + i];
-            }
-        } else {
-            for(int i = 0; i < len; i++) {
-                block cur_label = output_wire_label_recv[i];
-                block zero_label = labels[i + output_shift];
-                block one_label = zero_label ^ Delta;
-
-                if(cmpBlock(&cur_label, &zero_label, 1)) {
-                    masked_output[i] = false;
-                } else if(cmpBlock(&cur_label, &one_label, 1)) {
-                    masked_output[i] = true;
-                } else {
-                    error("Output label mismatched.\n");
-                }
-            }
+        vector<vector<int>> owned(nP + 1); // party_assignment[] > 0
+        vector<int> authenticated;          // party_assignment[] == -1
+        vector<int> pub;                    // party_assignment[] == 0
+        for(int i = 0; i < len; i++) {
+            if(party_assignment[i] > 0)
+                owned[party_assignment[i]].push_back(i);
+            else if(party_assignment[i] == -1)
+                authenticated.push_back(i);
+            else
+                pub.push_back(i);
         }
 
-        /*
-         * Decide the broadcasting of the shares of r, as well as their MAC
-         */
-        vector<vector<BitWithMac>> output_mask_send;
-        output_mask_send.resize(nP + 1);
-        for(int j = 1; j <= nP; j++) {
-            BitWithMac empty_mbit{};
-            output_mask_send[j].resize(len, empty_mbit);
-        }
+        vector<int>& mine = owned[party];
+        size_t max_owned = 0;
+        for(int j = 1; j <= nP; j++)
+            max_owned = std::max(max_owned, owned[j].size());
 
-        for(int i = 0; i < len; i++) {
-            if(party_assignment[i] == -1) {
-                // do nothing, just update the share (for the first party) later
-            } else if(party_assignment[i] == 0) {
-                // public output, all parties receive the mbit
-                for(int j = 1; j <= nP; j++){
-                    output_mask_send[j][i].bit_share = value[output_shift + i];
-                    output_mask_send[j][i].mac = mac->at(j, output_shift + i);
-                }
-            } else {
-                // only one party is supposed to receive the mbit
-                int cur_party = party_assignment[i];
-                output_mask_send[cur_party][i].bit_share = value[output_shift + i];
-                output_mask_send[cur_party][i].mac = mac->at(cur_party, output_shift + i);
-            }
-        }
+        /* the mask shares received from each peer: mine, public */
+        NVec<bool> recv_bits_from(nP + 1, mine.size() + pub.size());
+        char (*dgst)[Hash::DIGEST_SIZE] = new char[nP + 1][Hash::DIGEST_SIZE];
 
-        /*
-         * Exchange the output mask
-         */
-        vector<vector<BitWithMac>> output_mask_recv;
-        output_mask_recv.resize(nP + 1);
-        for(int j = 1; j <= nP; j++) {
-            output_mask_recv[j].resize(len);
-        }
+        size_t num_labels = mine.size() + authenticated.size() + pub.size();
+        Vec<block> recv_labels(party == ALICE ? 0 : num_labels);
+        Vec<block> send_labels(party == ALICE ? max_owned + authenticated.size() + pub.size() : 0);
+        Vec<bool> send_bits_buf(max_owned + pub.size());
 
         for (int i = 1; i <= nP; ++i) {
             for (int j = 1; j <= nP; ++j) {
                 if ((i < j) and (i == party or j == party)) {
                     int party2 = i + j - party;
 
-                    get_send_channel(*io, party2).send_data(output_mask_send[party2].data(), sizeof(BitWithMac) * len);
-                    io->flush(party2);
-                    get_recv_channel(*io, party2).recv_data(output_mask_recv[party2].data(), sizeof(BitWithMac) * len);
+                    if(party == ALICE) {
+                        size_t nl = 0;
+                        for(int k : owned[party2])
+                            send_labels[nl++] = (*eval_labels)(output_shift + k, party2);
+                        for(int k : authenticated)
+                            send_labels[nl++] = (*eval_labels)(output_shift + k, party2);
+                        for(int k : pub)
+                            send_labels[nl++] = (*eval_labels)(output_shift + k, party2);
+                        get_send_channel(*io, party2).send_data(send_labels.begin(), nl * sizeof(block));
+                    }
+
+                    Hash h;
+                    size_t nb = 0;
+                    for(vector<int>* idx : {&owned[party2], &pub}) {
+                        for(int k : *idx) {
+                            send_bits_buf[nb++] = value[output_shift + k];
+                            if(!semi_honest)
+                                h.put_block(&(*mac)(output_shift + k, party2));
+                        }
+                    }
+
+                    send_bits(get_send_channel(*io, party2), send_bits_buf.begin(), nb);
+                    if(!semi_honest) {
+                        h.digest(dgst[party]);
+                        get_send_channel(*io, party2).send_data(dgst[party], Hash::DIGEST_SIZE);
+                    }
                     io->flush(party2);
+
+                    if(party2 == ALICE)
+                        get_recv_channel(*io, party2).recv_data(recv_labels.begin(), num_labels * sizeof(block));
+                    recv_bits(get_recv_channel(*io, party2), recv_bits_from.row(party2), mine.size() + pub.size());
+                    if(!semi_honest)
+                        get_recv_channel(*io, party2).recv_data(dgst[party2], Hash::DIGEST_SIZE);
                 }
             }
         }
 
         /*
-         * Verify the output mask
+         * Each party extracts x ^ r of the output wires it needs
          */
-        vector<bool> res_check;
-        for (int j = 1; j <= nP; ++j) {
-            if(j != party) {
-                bool check = false;
-                for (int i = 0; i < len; i++) {
-                    if (party_assignment[i] == party || party_assignment[i] == 0) {
-                        block supposed_mac = Delta & select_mask[output_mask_recv[j][i].bit_share? 1 : 0];
-                        supposed_mac ^= key->at(j, output_shift + i);
-
-                        block provided_mac = output_mask_recv[j][i].mac;
+        vector<bool> masked_output(len);
 
-                        if(!cmpBlock(&supposed_mac, &provided_mac, 1)) {
-                            check = true;
-                            break;
-                        }
+        if(party == ALICE) {
+            for(int i = 0; i < len; i++)
+                masked_output[i] = masked_input_ret[output_shift + i];
+        } else {
+            const block *cur_label = recv_labels.begin();
+            for(vector<int>* idx : {&mine, &authenticated, &pub}) {
+                for(int k : *idx) {
+                    block zero_label = labels[output_shift + k];
+                    block one_label = zero_label ^ Delta;
+
+                    if(cmpBlock(cur_label, &zero_label, 1)) {
+                        masked_output[k] = false;
+                    } else if(cmpBlock(cur_label, &one_label, 1)) {
+                        masked_output[k] = true;
+                    } else {
+                        error("Output label mismatched.\n");
                     }
+                    ++cur_label;
                 }
-                res_check.push_back(check);
             }
         }
-        if(checkCheat(res_check)) error("cheat in FlexOut's output mask!");
 
         /*
-         * Handle the case party_assignment[] = -1
+         * Verify the output mask, the MACs are checked against the hash
          */
-        if(party == ALICE) {
-            for(int i = 0; i < len; i++) {
-                if(party_assignment[i] == -1) {
-                    authenticated_share_results[i].bit_share = value[output_shift + i] ^ masked_output[i];
-                    for(int j = 1; j <= nP; j++) {
-                        if(j != party) {
-                            authenticated_share_results[i].mac[j] = mac->at(j, output_shift + i);
-                            authenticated_share_results[i].key[j] = key->at(j, output_shift + i);
-                        }
-                    }
-                }
-            }
-        } else {
-            for(int i = 0; i < len; i++) {
-                if(party_assignment[i] == -1) {
-                    authenticated_share_results[i].bit_share = value[output_shift + i];
-                    for(int j = 1; j <= nP; j++) {
-                        if(j != party) {
-                            authenticated_share_results[i].mac[j] = mac->at(j, output_shift + i);
-                            if(j == ALICE) {
-                                authenticated_share_results[i].key[j] =
-                                        key->at(j, output_shift + i) ^ (Delta & select_mask[masked_output[i] ? 1 : 0]);
-                                // change the MAC key for the first party
-                            } else {
-                                authenticated_share_results[i].key[j] = key->at(j, output_shift + i);
-                            }
-                        }
+        vector<bool> res_check;
+        for (int j = 1; j <= nP; ++j) {
+            if(j != party and !semi_honest) {
+                const bool *bits = recv_bits_from.row(j);
+                Hash h;
+                for(vector<int>* idx : {&mine, &pub}) {
+                    for(int k : *idx) {
+                        block supposed_mac = (*key)(output_shift + k, j) ^ (Delta & select_mask[*bits++ ? 1 : 0]);
+                        h.put_block(&supposed_mac);
                     }
                 }
+                char tmp[Hash::DIGEST_SIZE];
+                h.digest(tmp);
+                res_check.push_back(memcmp(tmp, dgst[j], Hash::DIGEST_SIZE) != 0);
             }
         }
-
-        //print_block(Delta);
+        delete[] dgst;
+        if(checkCheat(res_check)) error("cheat in FlexOut's output mask!");
 
         /*
-        cout << "Debug the authenticated output" << endl;
-        for(int i = 0; i < 10; i++){
-            if(party_assignment[i] == -1) {
-                cout << "index: " << i << ", value: " << authenticated_share_results[i].bit_share << endl;
-                cout << "mac: " << endl;
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        //cout << j << ": ";
-                        print_block(authenticated_share_results[i].mac[j]);
-                    }
-                }
-                cout << "key: " << endl;
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        //cout << j << ": ";
-                        print_block(authenticated_share_results[i].key[j]);
-                        print_block(authenticated_share_results[i].key[j] ^ Delta);
-                    }
-                }
-                cout << "=============" << endl;
+         * Handle the case party_assignment[] = -1, the first party folds the
+         * public x ^ r into its share, the others into their key for it
+         */
+        if(!authenticated.empty() and authenticated_bit_share.empty()) {
+            authenticated_bit_share.resize(len);
+            authenticated_key.resize(len, nP + 1);
+            authenticated_mac.resize(len, nP + 1);
+        }
+        for(int k : authenticated) {
+            int w = output_shift + k;
+            authenticated_bit_share[k] = party == ALICE ? value[w] != masked_output[k] : value[w];
+            memcpy(authenticated_mac.row(k), mac->row(w), (nP + 1) * sizeof(block));
+            memcpy(authenticated_key.row(k), key->row(w), (nP + 1) * sizeof(block));
+            if(party != ALICE) {
+                // change the MAC key for the first party
+                authenticated_key(k, ALICE) ^= Delta & select_mask[masked_output[k] ? 1 : 0];
             }
         }
-         */
 
         /*
          * Handle the case party_assignment[] = 0 or == party
          */
-        for(int i = 0; i < len; i++) {
-            if(party_assignment[i] == 0 || party_assignment[i] == party) {
-                plaintext_results[i] = value[output_shift + i] ^ masked_output[i];
-                for(int j = 1; j <= nP; j++) {
-                    if(j != party) {
-                        plaintext_results[i] = plaintext_results[i] ^ output_mask_recv[j][i].bit_share;
-                    }
+        for(vector<int>* idx : {&mine, &pub}) {
+            for(int k : *idx)
+                plaintext_results[k] = value[output_shift + k] != masked_output[k];
+        }
+        for (int j = 1; j <= nP; ++j) {
+            if(j != party) {
+                const bool *bits = recv_bits_from.row(j);
+                for(vector<int>* idx : {&mine, &pub}) {
+                    for(int k : *idx)
+                        plaintext_results[k] = plaintext_results[k] != *bits++;
                 }
             }
         }
@@ -21,15 +21,20 @@ class FpreMP { public:
     PRG * prgs;
     PRG prg;
     int ssp;
+    // Only secure if every party follows the protocol: one leaky AND triple
+    // per AND gate, without the checks and bucketing that make it sound
+    bool semi_honest;
 
     FpreMP(
         std::shared_ptr<IMultiIO>& io,
         bool * _delta = nullptr,
-        int ssp = 40
+        int ssp = 40,
+        bool semi_honest = false
     ):
         io(io),
         nP(io->size()),
-        party(io->party())
+        party(io->party()),
+        semi_honest(semi_honest)
     {
         this ->ssp = ssp;
         abit = new ABitMP(io, _delta, ssp);
@@ -53,48 +58,46 @@ class FpreMP { public:
             return 4;
         else return 5;
     }
-    void compute(NVec<block>& MAC, NVec<block>& KEY, bool* r, int length) {
-        int64_t bucket_size = get_bucket_size(length);
-        NVec<block> tMAC(nP+1, length*bucket_size*3+3*ssp);
-        NVec<block> tKEY(nP+1, length*bucket_size*3+3*ssp);
-        NVec<block> tKEYphi(nP+1, length*bucket_size*3+3*ssp);
-        NVec<block> tMACphi(nP+1, length*bucket_size*3+3*ssp);
-        Vec<block> phi(length*bucket_size);
-        NVec<block> X(nP+1, ssp);
-        Vec<bool> tr(length*bucket_size*3+3*ssp);
+    void compute(NVec<block>& MAC, NVec<block>& KEY, bool* r, int64_t length) {
+        int64_t bucket_size = semi_honest ? 1 : get_bucket_size(length);
+        // the last 3*ssp bits are used up by abit->check
+        int64_t check_bits = semi_honest ? 0 : 3*ssp;
+        NVec<block> tMAC(nP+1, length*bucket_size*3+check_bits);
+        NVec<block> tKEY(nP+1, length*bucket_size*3+check_bits);
+        Vec<bool> tr(length*bucket_size*3+check_bits);
         NVec<bool> s(nP+1, length*bucket_size);
         Vec<bool> e(length*bucket_size);
 
-        prg.random_bool(&tr[0], length*bucket_size*3+3*ssp);
+        prg.random_bool(&tr[0], length*bucket_size*3+check_bits);
         // memset(tr, false, length*bucket_size*3+3*ssp);
-        abit->compute(tMAC, tKEY, &tr[0], length*bucket_size*3 + 3*ssp);
+        abit->compute(tMAC, tKEY, &tr[0], length*bucket_size*3 + check_bits);
 
         for(int i = 1; i <= nP; ++i) for(int j = 1; j <= nP; ++j) if (i < j ) {
             if(i == party) {
-                prgs[j].random_bool(&s.at(j, 0), length*bucket_size);
-                for(int k = 0; k < length*bucket_size; ++k) {
-                    uint8_t data = garble(&tKEY.at(j, 0), &tr[0], &s.at(j, 0), k, j);
+                prgs[j].random_bool(s.row(j), length*bucket_size);
+                for(int64_t k = 0; k < length*bucket_size; ++k) {
+                    uint8_t data = garble(tKEY.row(j), &tr[0], s.row(j), k, j);
                     get_send_channel(*io, j).send_data(&data, 1);
-                    s.at(j, k) = (s.at(j, k) != (tr[3*k] and tr[3*k+1]));
+                    s(j, k) = (s(j, k) != (tr[3*k] and tr[3*k+1]));
                 }
                 io->flush(j);
             } else if (j == party) {
-                for(int k = 0; k < length*bucket_size; ++k) {
+                for(int64_t k = 0; k < length*bucket_size; ++k) {
                     uint8_t data = 0;
                     get_recv_channel(*io, i).recv_data(&data, 1);
-                    bool tmp = evaluate(data, &tMAC.at(i, 0), &tr[0], k, i);
-                    s.at(i, k) = (tmp != (tr[3*k] and tr[3*k+1]));
+                    bool tmp = evaluate(data, tMAC.row(i), &tr[0], k, i);
+                    s(i, k) = (tmp != (tr[3*k] and tr[3*k+1]));
                 }
             }
         }
-        for(int k = 0; k < length*bucket_size; ++k) {
-            s.at(0, k) = (tr[3*k] and tr[3*k+1]);
+        for(int64_t k = 0; k < length*bucket_size; ++k) {
+            s(0, k) = (tr[3*k] and tr[3*k+1]);
             for(int i = 1; i <= nP; ++i)
                 if (i != party) {
-                    s.at(0, k) = (s.at(0, k) != s.at(i, k));
+                    s(0, k) = (s(0, k) != s(i, k));
                 }
-            e[k] = (s.at(0, k) != tr[3*k+2]);
-            tr[3*k+2] = s.at(0, k);
+            e[k] = (s(0, k) != tr[3*k+2]);
+            tr[3*k+2] = s(0, k);
         }
 
 #ifdef __debug
@@ -108,22 +111,37 @@ class FpreMP { public:
 
             bool * tmp = new bool[length*bucket_size];
             get_recv_channel(*io, party2).recv_data(tmp, length*bucket_size);
-            for(int k = 0; k < length*bucket_size; ++k) {
+            for(int64_t k = 0; k < length*bucket_size; ++k) {
                 if(tmp[k])
-                    tKEY.at(party2, 3*k+2) = tKEY.at(party2, 3*k+2) ^ Delta;
+                    tKEY(party2, 3*k+2) = tKEY(party2, 3*k+2) ^ Delta;
             }
             delete[] tmp;
         }
 #ifdef __debug
         check_MAC(nP, *io, tMAC, tKEY, &tr[0], Delta, length*bucket_size*3, party);
 #endif
+        if(semi_honest) {
+            // the leaky triples are used as they are
+            for(int j = 1; j <= nP; ++j) if (j != party) {
+                memcpy(MAC.row(j), tMAC.row(j), length*3*sizeof(block));
+                memcpy(KEY.row(j), tKEY.row(j), length*3*sizeof(block));
+            }
+            memcpy(r, &tr[0], length*3);
+            return;
+        }
+
+        NVec<block> tKEYphi(nP+1, length*bucket_size*3+3*ssp);
+        NVec<block> tMACphi(nP+1, length*bucket_size*3+3*ssp);
+        Vec<block> phi(length*bucket_size);
+        NVec<block> X(nP+1, ssp);
+
         abit->check(tMAC, tKEY, &tr[0], length*bucket_size*3 + 3*ssp);
         //check compute phi
-        for(int k = 0; k < length*bucket_size; ++k) {
+        for(int64_t k = 0; k < length*bucket_size; ++k) {
             phi[k] = zero_block;
             for(int i = 1; i <= nP; ++i) if (i != party) {
-                phi[k] = phi[k] ^ tKEY.at(i, 3*k+1);
-                phi[k] = phi[k] ^ tMAC.at(i, 3*k+1);
+                phi[k] = phi[k] ^ tKEY(i, 3*k+1);
+                phi[k] = phi[k] ^ tMAC(i, 3*k+1);
             }
             if(tr[3*k+1])phi[k] = phi[k] ^ Delta;
         }
@@ -134,11 +152,11 @@ class FpreMP { public:
             if (party < party2) {
                 {
                     block bH[2], tmpH[2];
-                    for(int k = 0; k < length*bucket_size; ++k) {
-                        bH[0] = tKEY.at(party2, 3*k);
+                    for(int64_t k = 0; k < length*bucket_size; ++k) {
+                        bH[0] = tKEY(party2, 3*k);
                         bH[1] = bH[0] ^ Delta;
                         HnID(prps+party2, bH, bH, 2*k, 2, tmpH);
-                        tKEYphi.at(party2, k) = bH[0];
+                        tKEYphi(party2, k) = bH[0];
                         bH[1] = bH[0] ^ bH[1];
                         bH[1] = phi[k] ^ bH[1];
                         get_send_channel(*io, party2).send_data(&bH[1], sizeof(block));
@@ -148,31 +166,31 @@ class FpreMP { public:
 
                 {
                     block bH;
-                    for(int k = 0; k < length*bucket_size; ++k) {
+                    for(int64_t k = 0; k < length*bucket_size; ++k) {
                         get_recv_channel(*io, party2).recv_data(&bH, sizeof(block));
-                        block hin = sigma(tMAC.at(party2, 3*k)) ^ makeBlock(0, 2*k+tr[3*k]);
-                        tMACphi.at(party2, k) = prps2[party2].H(hin);
-                        if(tr[3*k])tMACphi.at(party2, k) = tMACphi.at(party2, k) ^ bH;
+                        block hin = sigma(tMAC(party2, 3*k)) ^ makeBlock(0, 2*k+tr[3*k]);
+                        tMACphi(party2, k) = prps2[party2].H(hin);
+                        if(tr[3*k])tMACphi(party2, k) = tMACphi(party2, k) ^ bH;
                     }
                 }
             } else {
                 {
                     block bH;
-                    for(int k = 0; k < length*bucket_size; ++k) {
+                    for(int64_t k = 0; k < length*bucket_size; ++k) {
                         get_recv_channel(*io, party2).recv_data(&bH, sizeof(block));
-                        block hin = sigma(tMAC.at(party2, 3*k)) ^ makeBlock(0, 2*k+tr[3*k]);
-                        tMACphi.at(party2, k) = prps2[party2].H(hin);
-                        if(tr[3*k])tMACphi.at(party2, k) = tMACphi.at(party2, k) ^ bH;
+                        block hin = sigma(tMAC(party2, 3*k)) ^ makeBlock(0, 2*k+tr[3*k]);
+                        tMACphi(party2, k) = prps2[party2].H(hin);
+                        if(tr[3*k])tMACphi(party2, k) = tMACphi(party2, k) ^ bH;
                     }
                 }
 
                 {
                     block bH[2], tmpH[2];
-                    for(int k = 0; k < length*bucket_size; ++k) {
-                        bH[0] = tKEY.at(party2, 3*k);
+                    for(int64_t k = 0; k < length*bucket_size; ++k) {
+                        bH[0] = tKEY(party2, 3*k);
                         bH[1] = bH[0] ^ Delta;
                         HnID(prps+party2, bH, bH, 2*k, 2, tmpH);
-                        tKEYphi.at(party2, k) = bH[0];
+                        tKEYphi(party2, k) = bH[0];
                         bH[1] = bH[0] ^ bH[1];
                         bH[1] = phi[k] ^ bH[1];
                         get_send_channel(*io, party2).send_data(&bH[1], sizeof(block));
@@ -183,26 +201,26 @@ class FpreMP { public:
         }
 
         bool * xs = new bool[length*bucket_size];
-        for(int i = 0; i < length*bucket_size; ++i) xs[i] = tr[3*i];
+        for(int64_t i = 0; i < length*bucket_size; ++i) xs[i] = tr[3*i];
 
 #ifdef __debug
         check_MAC_phi(tMACphi, tKEYphi, &phi[0], xs, length*bucket_size);
 #endif
         //tKEYphti use as H
-        for(int k = 0; k < length*bucket_size; ++k) {
-            tKEYphi.at(party, k) = zero_block;
+        for(int64_t k = 0; k < length*bucket_size; ++k) {
+            tKEYphi(party, k) = zero_block;
             for(int i = 1; i <= nP; ++i) if (i != party) {
-                tKEYphi.at(party, k) = tKEYphi.at(party, k) ^ tKEYphi.at(i, k);
-                tKEYphi.at(party, k) = tKEYphi.at(party, k) ^ tMACphi.at(i, k);
-                tKEYphi.at(party, k) = tKEYphi.at(party, k) ^ tKEY.at(i, 3*k+2);
-                tKEYphi.at(party, k) = tKEYphi.at(party, k) ^ tMAC.at(i, 3*k+2);
+                tKEYphi(party, k) = tKEYphi(party, k) ^ tKEYphi(i, k);
+                tKEYphi(party, k) = tKEYphi(party, k) ^ tMACphi(i, k);
+                tKEYphi(party, k) = tKEYphi(party, k) ^ tKEY(i, 3*k+2);
+                tKEYphi(party, k) = tKEYphi(party, k) ^ tMAC(i, 3*k+2);
             }
-            if(tr[3*k])     tKEYphi.at(party, k) = tKEYphi.at(party, k) ^ phi[k];
-            if(tr[3*k+2])tKEYphi.at(party, k) = tKEYphi.at(party, k) ^ Delta;
+            if(tr[3*k])     tKEYphi(party, k) = tKEYphi(party, k) ^ phi[k];
+            if(tr[3*k+2])tKEYphi(party, k) = tKEYphi(party, k) ^ Delta;
         }
 
 #ifdef __debug
-        check_zero(&tKEYphi.at(party, 0), length*bucket_size);
+        check_zero(tKEYphi.row(party), length*bucket_size);
 #endif
 
         block prg_key = sampleRandom(nP, *io, &prg, party);
@@ -211,9 +229,9 @@ class FpreMP { public:
         bool * tmp = new bool[length*bucket_size];
         for(int i = 0; i < ssp; ++i) {
             prgf.random_bool(tmp, length*bucket_size);
-            X.at(party, i) = inProd(tmp, &tKEYphi.at(party, 0), length*bucket_size);
+            X(party, i) = inProd(tmp, tKEYphi.row(party), length*bucket_size);
         }
-        Hash::hash_once(dgst[party], &X.at(party, 0), sizeof(block)*ssp);
+        Hash::hash_once(dgst[party], X.row(party), sizeof(block)*ssp);
 
         for(int i = 1; i <= nP; ++i) for(int j = 1; j<= nP; ++j) if( (i < j) and (i == party or j == party) ) {
             int party2 = i + j - party;
@@ -225,50 +243,50 @@ class FpreMP { public:
 
         for(int i = 1; i <= nP; ++i) for(int j = 1; j<= nP; ++j) if( (i < j) and (i == party or j == party) ) {
             int party2 = i + j - party;
-            get_send_channel(*io, party2).send_data(&X.at(party, 0), sizeof(block)*ssp);
-            get_recv_channel(*io, party2).recv_data(&X.at(party2, 0), sizeof(block)*ssp);
+            get_send_channel(*io, party2).send_data(X.row(party), sizeof(block)*ssp);
+            get_recv_channel(*io, party2).recv_data(X.row(party2), sizeof(block)*ssp);
             char tmp[Hash::DIGEST_SIZE];
-            Hash::hash_once(tmp, &X.at(party2, 0), sizeof(block)*ssp);
+            Hash::hash_once(tmp, X.row(party2), sizeof(block)*ssp);
             res2.push_back(strncmp(tmp, dgst[party2], Hash::DIGEST_SIZE)!=0);
         }
         if(checkCheat(res2)) error("commitment");
 
         for(int i = 2; i <= nP; ++i)
-            xorBlocks_arr(&X.at(1, 0), &X.at(1, 0), &X.at(i, 0), ssp);
-        for(int i = 0; i < ssp; ++i)X.at(2, i) = zero_block;
-        if(!cmpBlock(&X.at(1, 0), &X.at(2, 0), ssp)) error("AND check");
+            xorBlocks_arr(X.row(1), X.row(1), X.row(i), ssp);
+        for(int i = 0; i < ssp; ++i)X(2, i) = zero_block;
+        if(!cmpBlock(X.row(1), X.row(2), ssp)) error("AND check");
 
         //land -> and
         block S = sampleRandom(nP, *io, &prg, party);
 
         int * ind = new int[length*bucket_size];
-        int *location = new int[length*bucket_size];
+        int64_t *location = new int64_t[length*bucket_size];
         NVec<bool> d(nP+1, length*(bucket_size-1));
-        for(int i = 0; i < length*bucket_size; ++i)
+        for(int64_t i = 0; i < length*bucket_size; ++i)
             location[i] = i;
         PRG prg2(&S);
         prg2.random_data(ind, length*bucket_size*4);
-        for(int i = length*bucket_size-1; i>=0; --i) {
-            int index = ind[i]%(i+1);
+        for(int64_t i = length*bucket_size-1; i>=0; --i) {
+            int64_t index = ind[i]%(i+1);
             index = index>0? index:(-1*index);
-            int tmp = location[i];
+            int64_t tmp = location[i];
             location[i] = location[index];
             location[index] = tmp;
         }
         delete[] ind;
 
-        for(int i = 0; i < length; ++i) {
-            for(int j = 0; j < bucket_size-1; ++j)
-                d.at(party, (bucket_size-1)*i+j) = tr[3*location[i*bucket_size]+1] != tr[3*location[i*bucket_size+1+j]+1];
+        for(int64_t i = 0; i < length; ++i) {
+            for(int64_t j = 0; j < bucket_size-1; ++j)
+                d(party, (bucket_size-1)*i+j) = tr[3*location[i*bucket_size]+1] != tr[3*location[i*bucket_size+1+j]+1];
             for(int j = 1; j <= nP; ++j) if (j!= party) {
-                memcpy(&MAC.at(j, 3*i), &tMAC.at(j, 3*location[i*bucket_size]), 3*sizeof(block));
-                memcpy(&KEY.at(j, 3*i), &tKEY.at(j, 3*location[i*bucket_size]), 3*sizeof(block));
+                memcpy(&MAC(j, 3*i), &tMAC(j, 3*location[i*bucket_size]), 3*sizeof(block));
+                memcpy(&KEY(j, 3*i), &tKEY(j, 3*location[i*bucket_size]), 3*sizeof(block));
                 for(int k = 1; k < bucket_size; ++k) {
-                    MAC.at(j, 3*i) = MAC.at(j, 3*i) ^ tMAC.at(j, 3*location[i*bucket_size+k]);
-                    KEY.at(j, 3*i) = KEY.at(j, 3*i) ^ tKEY.at(j, 3*location[i*bucket_size+k]);
+                    MAC(j, 3*i) = MAC(j, 3*i) ^ tMAC(j, 3*location[i*bucket_size+k]);
+                    KEY(j, 3*i) = KEY(j, 3*i) ^ tKEY(j, 3*location[i*bucket_size+k]);
 
-                    MAC.at(j, 3*i+2) = MAC.at(j, 3*i+2) ^ tMAC.at(j, 3*location[i*bucket_size+k]+2);
-                    KEY.at(j, 3*i+2) = KEY.at(j, 3*i+2) ^ tKEY.at(j, 3*location[i*bucket_size+k]+2);
+                    MAC(j, 3*i+2) = MAC(j, 3*i+2) ^ tMAC(j, 3*location[i*bucket_size+k]+2);
+                    KEY(j, 3*i+2) = KEY(j, 3*i+2) ^ tKEY(j, 3*location[i*bucket_size+k]+2);
                 }
             }
             memcpy(&r[3*i], &tr[3*location[i*bucket_size]], 3);
@@ -280,24 +298,24 @@ class FpreMP { public:
 
         for(int i = 1; i <= nP; ++i) for(int j = 1; j<= nP; ++j) if( (i < j) and (i == party or j == party) ) {
             int party2 = i + j - party;
-            get_send_channel(*io, party2).send_data(&d.at(party, 0), (bucket_size-1)*length);
+            get_send_channel(*io, party2).send_data(d.row(party), (bucket_size-1)*length);
             io->flush(party2);
-            get_recv_channel(*io, party2).recv_data(&d.at(party2, 0), (bucket_size-1)*length);
+            get_recv_channel(*io, party2).recv_data(d.row(party2), (bucket_size-1)*length);
         }
         for(int i = 2; i <= nP; ++i)
-            for(int j = 0; j <  (bucket_size-1)*length; ++j)
-                d.at(1, j) = d.at(1, j) != d.at(i, j);
+            for(int64_t j = 0; j <  (bucket_size-1)*length; ++j)
+                d(1, j) = d(1, j) != d(i, j);
 
-        for(int i = 0; i < length; ++i)  {
+        for(int64_t i = 0; i < length; ++i)  {
             for(int j = 1; j <= nP; ++j)if (j!= party) {
                 for(int k = 1; k < bucket_size; ++k)
-                    if(d.at(1, (bucket_size-1)*i+k-1)) {
-                        MAC.at(j, 3*i+2) = MAC.at(j, 3*i+2) ^ tMAC.at(j, 3*location[i*bucket_size+k]);
-                        KEY.at(j, 3*i+2) = KEY.at(j, 3*i+2) ^ tKEY.at(j, 3*location[i*bucket_size+k]);
+                    if(d(1, (bucket_size-1)*i+k-1)) {
+                        MAC(j, 3*i+2) = MAC(j, 3*i+2) ^ tMAC(j, 3*location[i*bucket_size+k]);
+                        KEY(j, 3*i+2) = KEY(j, 3*i+2) ^ tKEY(j, 3*location[i*bucket_size+k]);
                     }
             }
             for(int k = 1; k < bucket_size; ++k)
-                if(d.at(1, (bucket_size-1)*i+k-1)) {
+                if(d(1, (bucket_size-1)*i+k-1)) {
                     r[3*i+2] = r[3*i+2] != tr[3*location[i*bucket_size+k]];
                 }
         }
@@ -311,7 +329,7 @@ class FpreMP { public:
     }
 
     //TODO: change to justGarble
-    uint8_t garble(block * KEY, bool * r, bool * r2, int i, int I) {
+    uint8_t garble(block * KEY, bool * r, bool * r2, int64_t i, int I) {
         uint8_t data = 0;
         block tmp[4], tmp2[4], tmpH[4];
         tmp[0] = KEY[3*i];
@@ -339,7 +357,7 @@ class FpreMP { public:
             data = data ^ 0x8;
         return data;
     }
-    bool evaluate(uint8_t tmp, block * MAC, bool * r, int i, int I) {
+    bool evaluate(uint8_t tmp, block * MAC, bool * r, int64_t i, int I) {
         block hin = sigma(MAC[3*i]) ^ makeBlock(0, 4*i + r[3*i]);
         block hin2 = sigma(MAC[3*i+1]) ^ makeBlock(0, 4*i + 2 + r[3*i+1]);
         block bH = prps[I].H(hin) ^ prps[I].H(hin2);
@@ -348,21 +366,21 @@ class FpreMP { public:
         return (tmp&0x1) != (res&0x1);
     }
 
-    void check_MAC_phi(const NVec<block>& MAC, const NVec<block>& KEY, block * phi, bool * r, int length) {
+    void check_MAC_phi(const NVec<block>& MAC, const NVec<block>& KEY, block * phi, bool * r, int64_t length) {
         block * tmp = new block[length];
         block *tD = new block[length];
         for(int i = 1; i <= nP; ++i) for(int j = 1; j <= nP; ++j) if (i < j) {
             if(party == i) {
                 get_send_channel(*io, j).send_data(phi, length*sizeof(block));
-                get_send_channel(*io, j).send_data(&KEY.at(j, 0), sizeof(block)*length);
+                get_send_channel(*io, j).send_data(KEY.row(j), sizeof(block)*length);
                 io->flush(j);
             } else if(party == j) {
                 get_recv_channel(*io, i).recv_data(tD, length*sizeof(block));
                 get_recv_channel(*io, i).recv_data(tmp, sizeof(block)*length);
-                for(int k = 0; k < length; ++k) {
+                for(int64_t k = 0; k < length; ++k) {
                     if(r[k])tmp[k] = tmp[k] ^ tD[k];
                 }
-                if(!cmpBlock(&MAC.at(i, 0), tmp, length))
+                if(!cmpBlock(MAC.row(i), tmp, length))
                     error("check_MAC_phi failed!");
             }
         }
@@ -373,7 +391,7 @@ class FpreMP { public:
     }
 
 
-    void check_zero(block * b, int l) {
+    void check_zero(block * b, int64_t l) {
         if(party == 1) {
             block * tmp1 = new block[l];
             block * tmp2 = new block[l];
@@ -383,7 +401,7 @@ class FpreMP { public:
                 xorBlocks_arr(tmp1, tmp1, tmp2, l);
             }
             block z = zero_block;
-            for(int i = 0; i < l; ++i)
+            for(int64_t i = 0; i < l; ++i)
                 if(!cmpBlock(&z, &tmp1[i], 1))
                     error("check sum zero failed!");
             cerr<<"check zero sum pass!\n"<<flush;
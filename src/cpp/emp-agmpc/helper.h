@@ -15,9 +15,9 @@ using std::flush;
 
 const static block inProdTableBlock[] = {zero_block, all_one_block};
 
-block inProd(bool * b, block * blk, int length) {
+block inProd(bool * b, block * blk, int64_t length) {
         block res = zero_block;
-        for(int i = 0; i < length; ++i)
+        for(int64_t i = 0; i < length; ++i)
 //            if(b[i])
 //                res = res ^ blk[i];
             res = res ^ (inProdTableBlock[b[i]] & blk[i]);
@@ -49,9 +49,9 @@ void inProds(block *Ms,  bool * tmp[ssp], block * MAC, int length) {
         inProdhelp<ssp>(Ms, tmp, MAC, i);
     }
 }
-bool inProd(bool * b, bool* b2, int length) {
+bool inProd(bool * b, bool* b2, int64_t length) {
         bool res = false;
-        for(int i = 0; i < length; ++i)
+        for(int64_t i = 0; i < length; ++i)
             res = (res != (b[i] and b2[i]));
         return res;
 }
@@ -82,6 +82,21 @@ void recv_partial_block(IOChannel& io, block * data, int length) {
     }
 }
 
+// Bools packed 8 to a byte, in one send
+void send_bits(IOChannel& io, const bool * data, size_t length) {
+    vector<uint8_t> packed((length + 7) / 8, 0);
+    for(size_t i = 0; i < length; ++i)
+        packed[i / 8] |= data[i] << (i % 8);
+    io.send_data(packed.data(), packed.size());
+}
+
+void recv_bits(IOChannel& io, bool * data, size_t length) {
+    vector<uint8_t> packed((length + 7) / 8);
+    io.recv_data(packed.data(), packed.size());
+    for(size_t i = 0; i < length; ++i)
+        data[i] = (packed[i / 8] >> (i % 8)) & 1;
+}
+
 block sampleRandom(int nP, IMultiIO& io, PRG * prg, int party) {
     vector<bool> res2;
     char (*dgst)[Hash::DIGEST_SIZE] = new char[nP+1][Hash::DIGEST_SIZE];
@@ -122,7 +137,7 @@ void check_MAC(
     const NVec<block>& KEY,
     bool * r,
     block Delta,
-    int length,
+    int64_t length,
     int party
 ) {
     block * tmp = new block[length];
@@ -135,7 +150,7 @@ void check_MAC(
         } else if(party == j) {
             get_recv_channel(io, i).recv_data(&tD, sizeof(block));
             get_recv_channel(io, i).recv_data(tmp, sizeof(block)*length);
-            for(int k = 0; k < length; ++k) {
+            for(int64_t k = 0; k < length; ++k) {
                 if(r[k])tmp[k] = tmp[k] ^ tD;
             }
             if(!cmpBlock(&MAC.at(i, 0), tmp, length))
@@ -147,17 +162,26 @@ void check_MAC(
         cerr<<"check_MAC pass!\n"<<flush;
 }
 
-void check_correctness(int nP, IMultiIO& io, bool * r, int length, int party) {
+// Party-major copy of a wire-major share array, for check_MAC
+NVec<block> to_party_major(const NVec<block>& shares) {
+    NVec<block> res(shares.dim(1), shares.dim(0));
+    for(size_t i = 0; i < shares.dim(0); ++i)
+        for(size_t j = 0; j < shares.dim(1); ++j)
+            res(j, i) = shares(i, j);
+    return res;
+}
+
+void check_correctness(int nP, IMultiIO& io, bool * r, int64_t length, int party) {
     if (party == 1) {
         bool * tmp1 = new bool[length*3];
         bool * tmp2 = new bool[length*3];
         memcpy(tmp1, r, length*3);
         for(int i = 2; i <= nP; ++i) {
             get_recv_channel(io, i).recv_data(tmp2, length*3);
-            for(int k = 0; k < length*3; ++k)
+            for(int64_t k = 0; k < length*3; ++k)
                 tmp1[k] = (tmp1[k] != tmp2[k]);
         }
-        for(int k = 0; k < length; ++k) {
+        for(int64_t k = 0; k < length; ++k) {
             if((tmp1[3*k] and tmp1[3*k+1]) != tmp1[3*k+2])
                 error("check_correctness failed!");
         }
@@ -14,16 +14,18 @@ class CMPC { public:
     const block MASK = makeBlock(0x0ULL, 0xFFFFFULL);
     FpreMP* fpre = nullptr;
 
-    NVec<block> mac; // dim: parties, wires
-    NVec<block> key; // dim: parties, wires
+    // Wire-major, so the nP shares of one wire are contiguous and free-XOR
+    // propagates all parties of a wire as one span
+    NVec<block> mac; // dim: wires, parties
+    NVec<block> key; // dim: wires, parties
     Vec<bool> value; // dim: wires
 
     NVec<block> preprocess_mac; // dim: parties, total_pre
     NVec<block> preprocess_key; // dim: parties, total_pre
     Vec<bool> preprocess_value; // dim: total_pre
 
-    NVec<block> sigma_mac; // dim: parties, num_ands
-    NVec<block> sigma_key; // dim: parties, num_ands
+    NVec<block> sigma_mac; // dim: num_ands, parties
+    NVec<block> sigma_key; // dim: num_ands, parties
     Vec<bool> sigma_value; // dim: num_ands
 
     NVec<block> ANDS_mac; // dim: parties, num_ands*3
@@ -36,24 +38,31 @@ class CMPC { public:
     int nP;
     int num_ands = 0, num_in;
     int party, total_pre, ssp;
+    // Skips the checks that catch deviating parties, see FpreMP
+    bool semi_honest;
     block Delta;
 
-    NVec<block> GTM; // dim: num_ands, 4, parties
-    NVec<block> GTK; // dim: num_ands, 4, parties
+    NVec<block, 3> GTM; // dim: num_ands, 4, parties
+    NVec<block, 3> GTK; // dim: num_ands, 4, parties
     NVec<bool> GTv; // dim: num_ands, 4
-    NVec<block> GT; // dim: num_ands, parties, 4, parties
-    NVec<block> eval_labels; // dim: parties, wires
+    NVec<block, 4> GT; // dim: num_ands, parties, 4, parties
+    NVec<block> eval_labels; // dim: wires, parties
+    // fixed key, so ECB calls only read it and the evaluator threads share it
     PRP prp;
+    // party 1 spreads each circuit level's AND gates over this
+    std::shared_ptr<ThreadPool> pool;
 
     CMPC(
         std::shared_ptr<IMultiIO>& io,
         BristolFormat * cf,
         bool * _delta = nullptr,
-        int ssp = 40
+        int ssp = 40,
+        bool semi_honest = false
     ):
         io(io),
         nP(io->size()),
-        party(io->party())
+        party(io->party()),
+        semi_honest(semi_honest)
     {
         this->cf = cf;
         this->ssp = ssp;
@@ -63,11 +72,13 @@ class CMPC { public:
                 ++num_ands;
         }
         num_in = cf->n1+cf->n2;
-        total_pre = num_in + num_ands + 3*ssp;
-        fpre = new FpreMP(io, _delta, ssp);
+        total_pre = num_in + num_ands + (semi_honest ? 0 : 3*ssp);
+        fpre = new FpreMP(io, _delta, ssp, semi_honest);
         Delta = fpre->Delta;
 
         if(party == 1) {
+            if(online_threads > 1)
+                pool = shared_thread_pool(online_threads);
             GTM.resize(num_ands, 4, nP+1);
             GTK.resize(num_ands, 4, nP+1);
             GTv.resize(num_ands, 4);
@@ -75,15 +86,15 @@ class CMPC { public:
         }
 
         labels.resize(cf->num_wire);
-        key.resize(nP+1, cf->num_wire);
-        mac.resize(nP+1, cf->num_wire);
+        key.resize(cf->num_wire, nP+1);
+        mac.resize(cf->num_wire, nP+1);
         ANDS_key.resize(nP+1, num_ands*3);
         ANDS_mac.resize(nP+1, num_ands*3);
         preprocess_mac.resize(nP+1, total_pre);
         preprocess_key.resize(nP+1, total_pre);
-        sigma_mac.resize(nP+1, num_ands);
-        sigma_key.resize(nP+1, num_ands);
-        eval_labels.resize(nP+1, cf->num_wire);
+        sigma_mac.resize(num_ands, nP+1);
+        sigma_key.resize(num_ands, nP+1);
+        eval_labels.resize(cf->num_wire, nP+1);
 
         value.resize(cf->num_wire);
         ANDS_value.resize(num_ands*3);
@@ -103,11 +114,12 @@ class CMPC { public:
 
         prg.random_bool(&preprocess_value[0], total_pre);
         fpre->abit->compute(preprocess_mac, preprocess_key, &preprocess_value[0], total_pre);
-        fpre->abit->check(preprocess_mac, preprocess_key, &preprocess_value[0], total_pre);
+        if(!semi_honest)
+            fpre->abit->check(preprocess_mac, preprocess_key, &preprocess_value[0], total_pre);
 
-        for(int i = 1; i <= nP; ++i) {
-            memcpy(&key.at(i, 0), &preprocess_key.at(i, 0), num_in * sizeof(block));
-            memcpy(&mac.at(i, 0), &preprocess_mac.at(i, 0), num_in * sizeof(block));
+        for(int i = 0; i < num_in; ++i) for(int j = 1; j <= nP; ++j) {
+            key(i, j) = preprocess_key(j, i);
+            mac(i, j) = preprocess_mac(j, i);
         }
         memcpy(&value[0], &preprocess_value[0], num_in * sizeof(bool));
 #ifdef __debug
@@ -125,8 +137,8 @@ class CMPC { public:
         for(int i = 0; i < cf->num_gate; ++i) {
             if (cf->gates[4*i+3] == AND_GATE) {
                 for(int j = 1; j <= nP; ++j) {
-                    key.at(j, cf->gates[4*i+2]) = preprocess_key.at(j, ands);
-                    mac.at(j, cf->gates[4*i+2]) = preprocess_mac.at(j, ands);
+                    key(cf->gates[4*i+2], j) = preprocess_key(j, ands);
+                    mac(cf->gates[4*i+2], j) = preprocess_mac(j, ands);
                 }
                 value[cf->gates[4*i+2]] = preprocess_value[ands];
                 ++ands;
@@ -135,18 +147,14 @@ class CMPC { public:
 
         for(int i = 0; i < cf->num_gate; ++i) {
             if (cf->gates[4*i+3] == XOR_GATE) {
-                for(int j = 1; j <= nP; ++j) {
-                    key.at(j, cf->gates[4*i+2]) = key.at(j, cf->gates[4*i]) ^ key.at(j, cf->gates[4*i+1]);
-                    mac.at(j, cf->gates[4*i+2]) = mac.at(j, cf->gates[4*i]) ^ mac.at(j, cf->gates[4*i+1]);
-                }
+                xorBlocks_arr(key.row(cf->gates[4*i+2]), key.row(cf->gates[4*i]), key.row(cf->gates[4*i+1]), nP+1);
+                xorBlocks_arr(mac.row(cf->gates[4*i+2]), mac.row(cf->gates[4*i]), mac.row(cf->gates[4*i+1]), nP+1);
                 value[cf->gates[4*i+2]] = value[cf->gates[4*i]] != value[cf->gates[4*i+1]];
                 if(party != 1)
                     labels[cf->gates[4*i+2]] = labels[cf->gates[4*i]] ^ labels[cf->gates[4*i+1]];
             } else if (cf->gates[4*i+3] == NOT_GATE) {
-                for(int j = 1; j <= nP; ++j) {
-                    key.at(j, cf->gates[4*i+2]) = key.at(j, cf->gates[4*i]);
-                    mac.at(j, cf->gates[4*i+2]) = mac.at(j, cf->gates[4*i]);
-                }
+                memcpy(key.row(cf->gates[4*i+2]), key.row(cf->gates[4*i]), (nP+1)*sizeof(block));
+                memcpy(mac.row(cf->gates[4*i+2]), mac.row(cf->gates[4*i]), (nP+1)*sizeof(block));
                 value[cf->gates[4*i+2]] = value[cf->gates[4*i]];
                 if(party != 1)
                     labels[cf->gates[4*i+2]] = labels[cf->gates[4*i]] ^ Delta;
@@ -154,14 +162,14 @@ class CMPC { public:
         }
 
 #ifdef __debug
-        check_MAC(nP, *io, mac, key, &value[0], Delta, cf->num_wire, party);
+        check_MAC(nP, *io, to_party_major(mac), to_party_major(key), &value[0], Delta, cf->num_wire, party);
 #endif
 
         ands = 0;
         for(int i = 0; i < cf->num_gate; ++i) {
             if (cf->gates[4*i+3] == AND_GATE) {
-                x.at(party, ands) = value[cf->gates[4*i]] != ANDS_value[3*ands];
-                y.at(party, ands) = value[cf->gates[4*i+1]] != ANDS_value[3*ands+1];
+                x(party, ands) = value[cf->gates[4*i]] != ANDS_value[3*ands];
+                y(party, ands) = value[cf->gates[4*i+1]] != ANDS_value[3*ands+1];
                 ands++;
             }
         }
@@ -169,44 +177,44 @@ class CMPC { public:
         for(int i = 1; i <= nP; ++i) for(int j = 1; j <= nP; ++j) if( (i < j) and (i == party or j == party) ) {
             int party2 = i + j - party;
 
-            get_send_channel(*io, party2).send_data(&x.at(party, 0), num_ands);
-            get_send_channel(*io, party2).send_data(&y.at(party, 0), num_ands);
+            get_send_channel(*io, party2).send_data(x.row(party), num_ands);
+            get_send_channel(*io, party2).send_data(y.row(party), num_ands);
             io->flush(party2);
 
-            get_recv_channel(*io, party2).recv_data(&x.at(party2, 0), num_ands);
-            get_recv_channel(*io, party2).recv_data(&y.at(party2, 0), num_ands);
+            get_recv_channel(*io, party2).recv_data(x.row(party2), num_ands);
+            get_recv_channel(*io, party2).recv_data(y.row(party2), num_ands);
         }
         for(int i = 2; i <= nP; ++i) for(int j = 0; j < num_ands; ++j) {
-            x.at(1, j) = x.at(1, j) != x.at(i, j);
-            y.at(1, j) = y.at(1, j) != y.at(i, j);
+            x(1, j) = x(1, j) != x(i, j);
+            y(1, j) = y(1, j) != y(i, j);
         }
 
         ands = 0;
         for(int i = 0; i < cf->num_gate; ++i) {
             if (cf->gates[4*i+3] == AND_GATE) {
                 for(int j = 1; j <= nP; ++j) {
-                    sigma_mac.at(j, ands) = ANDS_mac.at(j, 3*ands+2);
-                    sigma_key.at(j, ands) = ANDS_key.at(j, 3*ands+2);
+                    sigma_mac(ands, j) = ANDS_mac(j, 3*ands+2);
+                    sigma_key(ands, j) = ANDS_key(j, 3*ands+2);
                 }
                 sigma_value[ands] = ANDS_value[3*ands+2];
 
-                if(x.at(1, ands)) {
+                if(x(1, ands)) {
                     for(int j = 1; j <= nP; ++j) {
-                        sigma_mac.at(j, ands) = sigma_mac.at(j, ands) ^ ANDS_mac.at(j, 3*ands+1);
-                        sigma_key.at(j, ands) = sigma_key.at(j, ands) ^ ANDS_key.at(j, 3*ands+1);
+                        sigma_mac(ands, j) = sigma_mac(ands, j) ^ ANDS_mac(j, 3*ands+1);
+                        sigma_key(ands, j) = sigma_key(ands, j) ^ ANDS_key(j, 3*ands+1);
                     }
                     sigma_value[ands] = sigma_value[ands] != ANDS_value[3*ands+1];
                 }
-                if(y.at(1, ands)) {
+                if(y(1, ands)) {
                     for(int j = 1; j <= nP; ++j) {
-                        sigma_mac.at(j, ands) = sigma_mac.at(j, ands) ^ ANDS_mac.at(j, 3*ands);
-                        sigma_key.at(j, ands) = sigma_key.at(j, ands) ^ ANDS_key.at(j, 3*ands);
+                        sigma_mac(ands, j) = sigma_mac(ands, j) ^ ANDS_mac(j, 3*ands);
+                        sigma_key(ands, j) = sigma_key(ands, j) ^ ANDS_key(j, 3*ands);
                     }
                     sigma_value[ands] = sigma_value[ands] != ANDS_value[3*ands];
                 }
-                if(x.at(1, ands) and y.at(1, ands)) {
+                if(x(1, ands) and y(1, ands)) {
                     if(party != 1)
-                        sigma_key.at(1, ands) = sigma_key.at(1, ands) ^ Delta;
+                        sigma_key(ands, 1) = sigma_key(ands, 1) ^ Delta;
                     else
                         sigma_value[ands] = not sigma_value[ands];
                 }
@@ -237,31 +245,29 @@ class CMPC { public:
                 r[2] = r[0] != value[cf->gates[4*i+1]];
                 r[3] = r[1] != value[cf->gates[4*i+1]];
 
-                for(int j = 1; j <= nP; ++j) {
-                    M.at(0, j) = sigma_mac.at(j, ands) ^ mac.at(j, cf->gates[4*i+2]);
-                    M.at(1, j) = M.at(0, j) ^ mac.at(j, cf->gates[4*i]);
-                    M.at(2, j) = M.at(0, j) ^ mac.at(j, cf->gates[4*i+1]);
-                    M.at(3, j) = M.at(1, j) ^ mac.at(j, cf->gates[4*i+1]);
-
-                    K.at(0, j) = sigma_key.at(j, ands) ^ key.at(j, cf->gates[4*i+2]);
-                    K.at(1, j) = K.at(0, j) ^ key.at(j, cf->gates[4*i]);
-                    K.at(2, j) = K.at(0, j) ^ key.at(j, cf->gates[4*i+1]);
-                    K.at(3, j) = K.at(1, j) ^ key.at(j, cf->gates[4*i+1]);
-                }
-                K.at(3, 1) = K.at(3, 1) ^ Delta;
+                xorBlocks_arr(M.row(0), sigma_mac.row(ands), mac.row(cf->gates[4*i+2]), nP+1);
+                xorBlocks_arr(M.row(1), M.row(0), mac.row(cf->gates[4*i]), nP+1);
+                xorBlocks_arr(M.row(2), M.row(0), mac.row(cf->gates[4*i+1]), nP+1);
+                xorBlocks_arr(M.row(3), M.row(1), mac.row(cf->gates[4*i+1]), nP+1);
+
+                xorBlocks_arr(K.row(0), sigma_key.row(ands), key.row(cf->gates[4*i+2]), nP+1);
+                xorBlocks_arr(K.row(1), K.row(0), key.row(cf->gates[4*i]), nP+1);
+                xorBlocks_arr(K.row(2), K.row(0), key.row(cf->gates[4*i+1]), nP+1);
+                xorBlocks_arr(K.row(3), K.row(1), key.row(cf->gates[4*i+1]), nP+1);
+                K(3, 1) = K(3, 1) ^ Delta;
 
                 Hash(H, labels[cf->gates[4*i]], labels[cf->gates[4*i+1]], ands);
                 for(int j = 0; j < 4; ++j) {
                     for(int k = 1; k <= nP; ++k) if(k != party) {
-                        H.at(j, k) = H.at(j, k) ^ M.at(j, k);
-                        H.at(j, party) = H.at(j, party) ^ K.at(j, k);
+                        H(j, k) = H(j, k) ^ M(j, k);
+                        H(j, party) = H(j, party) ^ K(j, k);
                     }
-                    H.at(j, party) = H.at(j, party) ^ labels[cf->gates[4*i+2]];
+                    H(j, party) = H(j, party) ^ labels[cf->gates[4*i+2]];
                     if(r[j])
-                        H.at(j, party) = H.at(j, party) ^ Delta;
+                        H(j, party) = H(j, party) ^ Delta;
                 }
                 for(int j = 0; j < 4; ++j)
-                    get_send_channel(*io, 1).send_data(&H.at(j, 1), sizeof(block)*(nP));
+                    get_send_channel(*io, 1).send_data(&H(j, 1), sizeof(block)*(nP));
                 ++ands;
             }
             io->flush(1);
@@ -270,7 +276,7 @@ class CMPC { public:
                 int party2 = i;
                 for(int i = 0; i < num_ands; ++i)
                     for(int j = 0; j < 4; ++j)
-                        get_recv_channel(*io, party2).recv_data(&GT.at(i, party2, j, 1), sizeof(block)*(nP));
+                        get_recv_channel(*io, party2).recv_data(&GT(i, party2, j, 1), sizeof(block)*(nP));
             }
             for(int i = 0; i < cf->num_gate; ++i) if(cf->gates[4*i+3] == AND_GATE) {
                 r[0] = sigma_value[ands] != value[cf->gates[4*i+2]];
@@ -279,20 +285,18 @@ class CMPC { public:
                 r[3] = r[1] != value[cf->gates[4*i+1]];
                 r[3] = r[3] != true;
 
-                for(int j = 1; j <= nP; ++j) {
-                    M.at(0, j) = sigma_mac.at(j, ands) ^ mac.at(j, cf->gates[4*i+2]);
-                    M.at(1, j) = M.at(0, j) ^ mac.at(j, cf->gates[4*i]);
-                    M.at(2, j) = M.at(0, j) ^ mac.at(j, cf->gates[4*i+1]);
-                    M.at(3, j) = M.at(1, j) ^ mac.at(j, cf->gates[4*i+1]);
-
-                    K.at(0, j) = sigma_key.at(j, ands) ^ key.at(j, cf->gates[4*i+2]);
-                    K.at(1, j) = K.at(0, j) ^ key.at(j, cf->gates[4*i]);
-                    K.at(2, j) = K.at(0, j) ^ key.at(j, cf->gates[4*i+1]);
-                    K.at(3, j) = K.at(1, j) ^ key.at(j, cf->gates[4*i+1]);
-                }
-                memcpy(&GTK.at(ands, 0, 0), &K.at(0, 0), sizeof(block)*4*(nP+1));
-                memcpy(&GTM.at(ands, 0, 0), &M.at(0, 0), sizeof(block)*4*(nP+1));
-                memcpy(&GTv.at(ands, 0), r, sizeof(bool)*4);
+                xorBlocks_arr(M.row(0), sigma_mac.row(ands), mac.row(cf->gates[4*i+2]), nP+1);
+                xorBlocks_arr(M.row(1), M.row(0), mac.row(cf->gates[4*i]), nP+1);
+                xorBlocks_arr(M.row(2), M.row(0), mac.row(cf->gates[4*i+1]), nP+1);
+                xorBlocks_arr(M.row(3), M.row(1), mac.row(cf->gates[4*i+1]), nP+1);
+
+                xorBlocks_arr(K.row(0), sigma_key.row(ands), key.row(cf->gates[4*i+2]), nP+1);
+                xorBlocks_arr(K.row(1), K.row(0), key.row(cf->gates[4*i]), nP+1);
+                xorBlocks_arr(K.row(2), K.row(0), key.row(cf->gates[4*i+1]), nP+1);
+                xorBlocks_arr(K.row(3), K.row(1), key.row(cf->gates[4*i+1]), nP+1);
+                memcpy(GTK.row(ands, 0), K.row(0), sizeof(block)*4*(nP+1));
+                memcpy(GTM.row(ands, 0), M.row(0), sizeof(block)*4*(nP+1));
+                memcpy(GTv.row(ands), r, sizeof(bool)*4);
                 ++ands;
             }
         }
@@ -304,24 +308,63 @@ class CMPC { public:
         T[2] = sigma(sigma(b));
         T[3] = sigma(sigma(b ^ Delta));
 
-        H.at(0, 0) = T[0] ^ T[2];
-        H.at(1, 0) = T[0] ^ T[3];
-        H.at(2, 0) = T[1] ^ T[2];
-        H.at(3, 0) = T[1] ^ T[3];
+        H(0, 0) = T[0] ^ T[2];
+        H(1, 0) = T[0] ^ T[3];
+        H(2, 0) = T[1] ^ T[2];
+        H(3, 0) = T[1] ^ T[3];
         for(int j = 0; j < 4; ++j) for(int i = 1; i <= nP; ++i) {
-            H.at(j, i) = H.at(j, 0) ^ makeBlock(4*idx+j, i);
+            H(j, i) = H(j, 0) ^ makeBlock(4*idx+j, i);
         }
         for(int j = 0; j < 4; ++j) {
-            prp.permute_block(&H.at(j, 1), nP);
+            prp.permute_block(&H(j, 1), nP);
         }
     }
 
-    void Hash(block* H, const block &a, const block& b, uint64_t idx, uint64_t row) {
-        H[0] = sigma(a) ^ sigma(sigma(b));
+    // Evaluates n independent AND gates (ids are their AND indices) with
+    // one PRP call. H holds n * (nP-1) * nP blocks and index n ints.
+    void eval_and_batch(const int *gates, const int *ids, int n, bool *mask_input, block *H, int *index) {
+        for(int t = 0; t < n; ++t) {
+            const int *g = &cf->gates[4*gates[t]];
+            index[t] = 2*mask_input[g[0]] + mask_input[g[1]];
+            for(int j = 2; j <= nP; ++j)
+                hash_in(&H[(t*(nP-1) + j-2) * nP], eval_labels(g[0], j), eval_labels(g[1], j), ids[t], index[t]);
+        }
+        prp.permute_block(H, n * (nP-1) * nP);
+
+        for(int t = 0; t < n; ++t) {
+            int ands = ids[t];
+            int out = cf->gates[4*gates[t]+2];
+            block *out_labels = eval_labels.row(out);
+            bool mask = GTv(ands, index[t]);
+
+            memcpy(out_labels + 2, &GTM(ands, index[t], 2), (nP-1)*sizeof(block));
+            for(int j = 2; j <= nP; ++j) {
+                // h[k-1] is the row of party k, h[0] checks the output mask
+                block *h = &H[(t*(nP-1) + j-2) * nP];
+                xorBlocks_arr(h, h, GT.row(ands, j, index[t]) + 1, nP);
+                xorBlocks_arr(out_labels + 2, out_labels + 2, h + 1, nP-1);
+
+                block t0 = GTK(ands, index[t], j) ^ Delta;
+
+                if(cmpBlock(h, &GTK(ands, index[t], j), 1))
+                    mask = mask != false;
+                else if(cmpBlock(h, &t0, 1))
+                    mask = mask != true;
+                else {
+                    throw std::runtime_error("no match GT!");
+                }
+            }
+            mask_input[out] = mask;
+        }
+    }
+
+    // PRP inputs of the nP rows H[0..nP-1] of table row `row` of AND gate idx,
+    // permuted by the caller so a whole batch of gates takes one call
+    void hash_in(block* H, const block &a, const block& b, uint64_t idx, uint64_t row) {
+        block h = sigma(a) ^ sigma(sigma(b));
         for(int i = 1; i <= nP; ++i) {
-            H[i] = H[0] ^ makeBlock(4*idx+row, i);
+            H[i-1] = h ^ makeBlock(4*idx+row, i);
         }
-        prp.permute_block(H+1, nP);
     }
 
     string tostring(bool a) {
@@ -331,7 +374,7 @@ class CMPC { public:
 
     void online (FlexIn* input, FlexOut* output) {
         bool * mask_input = new bool[cf->num_wire];
-        input->associate_cmpc(&value[0], mac, key, io, Delta);
+        input->associate_cmpc(&value[0], mac, key, io, Delta, semi_honest);
         input->input(mask_input);
 
         if(party!= 1) {
@@ -342,49 +385,56 @@ class CMPC { public:
             }
             io->flush(1);
         } else {
+            Vec<block> in_labels(num_in);
             for(int i = 2; i <= nP; ++i) {
                 int party2 = i;
-                get_recv_channel(*io, party2).recv_data(&eval_labels.at(party2, 0), num_in*sizeof(block));
+                get_recv_channel(*io, party2).recv_data(in_labels.begin(), num_in*sizeof(block));
+                for(int j = 0; j < num_in; ++j)
+                    eval_labels(j, party2) = in_labels[j];
             }
 
-            int ands = 0;
-            for(int i = 0; i < cf->num_gate; ++i) {
-                if (cf->gates[4*i+3] == XOR_GATE) {
-                    for(int j = 2; j<= nP; ++j)
-                        eval_labels.at(j, cf->gates[4*i+2]) = eval_labels.at(j, cf->gates[4*i]) ^ eval_labels.at(j, cf->gates[4*i+1]);
-                    mask_input[cf->gates[4*i+2]] = mask_input[cf->gates[4*i]] != mask_input[cf->gates[4*i+1]];
-                } else if (cf->gates[4*i+3] == AND_GATE) {
-                    int index = 2*mask_input[cf->gates[4*i]] + mask_input[cf->gates[4*i+1]];
-                    Vec<block> H(nP+1);
-                    for(int j = 2; j <= nP; ++j)
-                        eval_labels.at(j, cf->gates[4*i+2]) = GTM.at(ands, index, j);
-                    mask_input[cf->gates[4*i+2]] = GTv.at(ands, index);
-                    for(int j = 2; j <= nP; ++j) {
-                        Hash(&H.at(0), eval_labels.at(j, cf->gates[4*i]), eval_labels.at(j, cf->gates[4*i+1]), ands, index);
-                        xorBlocks_arr(&H.at(0), &H.at(0), &GT.at(ands, j, index, 0), nP+1);
-                        for(int k = 2; k <= nP; ++k)
-                            eval_labels.at(k, cf->gates[4*i+2]) = H.at(k) ^ eval_labels.at(k, cf->gates[4*i+2]);
-
-                        block t0 = GTK.at(ands, index, j) ^ Delta;
-
-                        if(cmpBlock(&H.at(1), &GTK.at(ands, index, j), 1))
-                            mask_input[cf->gates[4*i+2]] = mask_input[cf->gates[4*i+2]] != false;
-                        else if(cmpBlock(&H.at(1), &t0, 1))
-                            mask_input[cf->gates[4*i+2]] = mask_input[cf->gates[4*i+2]] != true;
-                        else {
-                            throw std::runtime_error("no match GT!");
-                        }
+            CircuitLevels levels(*cf);
+            int batch = std::min(online_and_batch, std::max(levels.max_and_width, 1));
+            int workers = pool ? pool->size() + 1 : 1;
+            // scratch per worker: PRP rows and table index of one batch
+            NVec<block> H(workers, batch * (nP-1) * nP);
+            NVec<int> index(workers, batch);
+
+            for(const CircuitLevels::Level& level : levels.levels) {
+                for(int i : level.free_gates) {
+                    if (cf->gates[4*i+3] == XOR_GATE) {
+                        xorBlocks_arr(eval_labels.row(cf->gates[4*i+2]), eval_labels.row(cf->gates[4*i]), eval_labels.row(cf->gates[4*i+1]), nP+1);
+                        mask_input[cf->gates[4*i+2]] = mask_input[cf->gates[4*i]] != mask_input[cf->gates[4*i+1]];
+                    } else {
+                        mask_input[cf->gates[4*i+2]] = not mask_input[cf->gates[4*i]];
+                        memcpy(eval_labels.row(cf->gates[4*i+2]), eval_labels.row(cf->gates[4*i]), (nP+1)*sizeof(block));
                     }
-                    ands++;
+                }
+
+                size_t num_batches = (level.and_gates.size() + batch - 1) / batch;
+                auto run = [&](size_t b, int w) {
+                    size_t start = b * batch;
+                    int n = std::min<size_t>(batch, level.and_gates.size() - start);
+                    eval_and_batch(&level.and_gates[start], &level.and_ids[start], n, mask_input, H.row(w), index.row(w));
+                };
+
+                if(workers == 1 or num_batches < 2) {
+                    for(size_t b = 0; b < num_batches; ++b)
+                        run(b, 0);
                 } else {
-                    mask_input[cf->gates[4*i+2]] = not mask_input[cf->gates[4*i]];
-                    for(int j = 2; j <= nP; ++j)
-                        eval_labels.at(j, cf->gates[4*i+2]) = eval_labels.at(j, cf->gates[4*i]);
+                    // each worker owns one scratch row and claims batches
+                    // until the level is done
+                    std::atomic<size_t> next{0};
+                    pool->parallel_for(std::min<size_t>(workers, num_batches), [&](int64_t w) {
+                        size_t b;
+                        while((b = next++) < num_batches)
+                            run(b, w);
+                    });
                 }
             }
         }
 
-        output->associate_cmpc(&value[0], mac, key, eval_labels, labels, io, Delta);
+        output->associate_cmpc(&value[0], mac, key, eval_labels, labels, io, Delta, semi_honest);
         output->output(mask_input, cf->num_wire - cf->n3);
 
         delete[] mask_input;
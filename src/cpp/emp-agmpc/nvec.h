@@ -1,20 +1,29 @@
 #ifndef NVECTOR_H
 #define NVECTOR_H
 
+#include <array>
+#include <cassert>
 #include <stdexcept>
-#include <initializer_list>
-#include <numeric>
 #include <cstddef>
 #include <utility>
 
 #include "vec.h"
 
-// N-dimensional vector class
-template <typename T>
+// N-dimensional vector class with the rank fixed at compile time, stored in
+// row-major order.
+//
+// at() checks every index and throws, operator() and row() are for hot loops
+// and only assert.
+template <typename T, size_t Rank = 2>
 class NVec {
+    static_assert(Rank > 0, "NVec needs at least one dimension.");
+
 public:
     // Default constructor
-    NVec() : total_size(0) {}
+    NVec() : total_size(0) {
+        dimensions.fill(0);
+        strides.fill(0);
+    }
 
     // Constructor taking sizes of each dimension
     template <typename... Dims>
@@ -25,60 +34,97 @@ public:
     // Resize method
     template <typename... Dims>
     void resize(Dims... dims) {
+        static_assert(sizeof...(Dims) == Rank, "Number of dimensions must match Rank.");
+
         // Store the sizes of each dimension
         dimensions = {static_cast<size_t>(dims)...};
 
-        // Calculate the total size of the data
-        total_size = std::accumulate(dimensions.begin(), dimensions.end(), 1ull, std::multiplies<>());
+        // Strides for row-major order, the last dimension is contiguous
+        size_t stride = 1;
+        for (size_t i = Rank; i-- > 0;) {
+            strides[i] = stride;
+            stride *= dimensions[i];
+        }
+        total_size = stride;
 
         // Allocate the storage
         data.resize(total_size);
     }
 
-    // Access element with variadic indices
+    // Bounds checked access
     template <typename... Indices>
     T& at(Indices... indices) {
-        static_assert(sizeof...(Indices) > 0, "At least one index must be specified.");
-        if (sizeof...(Indices) != dimensions.size()) {
-            throw std::out_of_range("Incorrect number of indices.");
-        }
-
-        size_t flat_index = compute_flat_index({static_cast<size_t>(indices)...});
-        return data.at(flat_index);
+        return data.begin()[checked_flat_index(indices...)];
     }
 
-    // Const access
     template <typename... Indices>
     const T& at(Indices... indices) const {
-        static_assert(sizeof...(Indices) > 0, "At least one index must be specified.");
-        if (sizeof...(Indices) != dimensions.size()) {
-            throw std::out_of_range("Incorrect number of indices.");
-        }
+        return data.begin()[checked_flat_index(indices...)];
+    }
 
-        size_t flat_index = compute_flat_index({static_cast<size_t>(indices)...});
-        return data.at(flat_index);
+    // Unchecked access
+    template <typename... Indices>
+    T& operator()(Indices... indices) {
+        return data.begin()[flat_index(indices...)];
     }
 
+    template <typename... Indices>
+    const T& operator()(Indices... indices) const {
+        return data.begin()[flat_index(indices...)];
+    }
+
+    // Start of the contiguous last dimension, e.g. mac.row(j) for the MACs of
+    // every wire with party j
+    template <typename... Indices>
+    T* row(Indices... indices) {
+        static_assert(sizeof...(Indices) == Rank - 1, "row() takes Rank - 1 indices.");
+        return data.begin() + flat_index(indices..., 0);
+    }
+
+    template <typename... Indices>
+    const T* row(Indices... indices) const {
+        static_assert(sizeof...(Indices) == Rank - 1, "row() takes Rank - 1 indices.");
+        return data.begin() + flat_index(indices..., 0);
+    }
+
+    size_t size() const { return total_size; }
+    size_t dim(size_t i) const { return dimensions[i]; }
+    size_t stride(size_t i) const { return strides[i]; }
+
 private:
-    std::vector<size_t> dimensions; // Sizes of each dimension
-    size_t total_size;              // Total size of the data
-    Vec<T> data;                    // Linear storage for the elements
+    std::array<size_t, Rank> dimensions; // Sizes of each dimension
+    std::array<size_t, Rank> strides;    // Elements between consecutive indices
+    size_t total_size;                   // Total size of the data
+    Vec<T> data;                         // Linear storage for the elements
 
-    // Compute the flat index from multi-dimensional indices
-    size_t compute_flat_index(const std::vector<size_t>& indices) const {
-        size_t flat_index = 0;
-        size_t stride = 1;
+    // Compute the flat index from multi-dimensional indices. Rank is a
+    // compile-time constant, so this unrolls to Rank - 1 multiply-adds.
+    template <typename... Indices>
+    size_t flat_index(Indices... indices) const {
+        static_assert(sizeof...(Indices) == Rank, "Number of indices must match Rank.");
+        const size_t idx[] = {static_cast<size_t>(indices)...};
+
+        size_t flat = idx[Rank - 1];
+        // <= so that row() works on an empty last dimension
+        assert(idx[Rank - 1] <= dimensions[Rank - 1]);
+        for (size_t i = 0; i + 1 < Rank; ++i) {
+            assert(idx[i] < dimensions[i]);
+            flat += idx[i] * strides[i];
+        }
+        return flat;
+    }
 
-        // Iterate dimensions in reverse for row-major order
-        for (size_t i = dimensions.size(); i-- > 0;) {
-            if (indices[i] >= dimensions[i]) {
+    template <typename... Indices>
+    size_t checked_flat_index(Indices... indices) const {
+        static_assert(sizeof...(Indices) == Rank, "Number of indices must match Rank.");
+        const size_t idx[] = {static_cast<size_t>(indices)...};
+
+        for (size_t i = 0; i < Rank; ++i) {
+            if (idx[i] >= dimensions[i]) {
                 throw std::out_of_range("Index out of bounds.");
             }
-            flat_index += indices[i] * stride;
-            stride *= dimensions[i];
         }
-
-        return flat_index;
+        return flat_index(indices...);
     }
 };
 
@@ -110,6 +110,11 @@ public:
         return data[index];
     }
 
+    T* begin() { return data; }
+    const T* begin() const { return data; }
+    T* end() { return data + size_; }
+    const T* end() const { return data + size_; }
+
     // Member functions
     void push_back(const T& value) {
         if (size_ == capacity) {
@@ -1,3 +1,4 @@
 #include "emp-ot/ot.h"
 #include "emp-ot/co.h"
 #include "emp-ot/iknp.h"
+#include "emp-ot/softspoken.h"
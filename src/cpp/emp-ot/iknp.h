@@ -34,13 +34,17 @@ public:
     bool malicious = false;
     block k0[128], k1[128];
 
-    IKNP(IOChannel io, bool malicious = false): io(io) {}
+    // When set, send_pre/recv_pre spread each chunk over the pool and
+    // overlap it with the network (native or pthread builds only)
+    ThreadPool * pool = nullptr;
+
+    IKNP(IOChannel io, bool malicious = false): io(io), malicious(malicious) {}
 
     ~IKNP() {
         delete_array_null(extended_r);
     }
 
-    void setup_send(const bool* in_s = nullptr, block * in_k0 = nullptr) {
+    virtual void setup_send(const bool* in_s = nullptr, block * in_k0 = nullptr) {
         setup = true;
         if(in_s == nullptr)
             prg.random_bool(s, 128);
@@ -60,7 +64,7 @@ public:
         Delta = bool_to_block(s);
     }
 
-    void setup_recv(block * in_k0 = nullptr, block * in_k1 =nullptr) {
+    virtual void setup_recv(block * in_k0 = nullptr, block * in_k1 =nullptr) {
         setup = true;
         if(in_k0 !=nullptr) {
             memcpy(k0, in_k0, 128*sizeof(block));
@@ -81,6 +85,10 @@ public:
     void send_pre(block * out, int64_t length) {
         if(not setup)
             setup_send();
+        if(pool != nullptr) {
+            send_pre_threaded(out, length);
+            return;
+        }
         int64_t j = 0;
         for (; j < length/block_size; ++j)
             send_pre_block(out + j*block_size, block_size);
@@ -97,13 +105,10 @@ public:
     void send_pre_block(block * out, int64_t len) {
         block t[block_size];
         block tmp[block_size];
-        int64_t local_block_size = (len+127)/128*128;
-        io.recv_block(tmp, local_block_size);
-        for(int64_t i = 0; i < 128; ++i) {
-            G0[i].random_data(t+(i*block_size/128), local_block_size/8);
-            if (s[i])
-                xorBlocks_arr(t+(i*block_size/128), t+(i*block_size/128), tmp+(i*local_block_size/128), local_block_size/128);
-        }
+        int64_t row_len = (len+127)/128;
+        io.recv_block(tmp, num_units()*row_len);
+        for(int64_t i = 0; i < num_units(); ++i)
+            send_unit(t, tmp, row_len, i);
         sse_trans((uint8_t *)(out), (uint8_t*)t, 128, block_size);
     }
 
@@ -122,6 +127,19 @@ public:
             block_r[length/128] = bool_to_block(tmp_bool_array);
         }
 
+        block local_r_block[2];
+        if(malicious) {
+            prg.random_bool(local_r, 256);
+            local_r_block[0] = bool_to_block(local_r);
+            local_r_block[1] = bool_to_block(local_r + 128);
+        }
+
+        if(pool != nullptr) {
+            recv_pre_threaded(out, block_r, local_r_block, length);
+            delete[] block_r;
+            return;
+        }
+
         int64_t j = 0;
         for (; j < length/block_size; ++j)
             recv_pre_block(out+j*block_size, block_r + (j*block_size/128), block_size);
@@ -131,13 +149,8 @@ public:
             memcpy(out+j*block_size, local_out, sizeof(block)*remain);
         }
 
-        if(malicious) {
-            block local_r_block[2];
-            prg.random_bool(local_r, 256);
-            local_r_block[0] = bool_to_block(local_r);
-            local_r_block[1] = bool_to_block(local_r + 128);
+        if(malicious)
             recv_pre_block(local_out, local_r_block, 256);
-        }
 
         delete[] block_r;
     }
@@ -145,18 +158,125 @@ public:
     void recv_pre_block(block * out, block * r, int64_t len) {
         block t[block_size];
         block tmp[block_size];
-        int64_t local_block_size = (len+127)/128 * 128;
-        for(int64_t i = 0; i < 128; ++i) {
-            G0[i].random_data(t+(i*block_size/128), local_block_size/8);
-            G1[i].random_data(tmp, local_block_size/8);
-            xorBlocks_arr(tmp, t+(i*block_size/128), tmp, local_block_size/128);
-            xorBlocks_arr(tmp, r, tmp, local_block_size/128);
-            io.send_data(tmp, local_block_size/8);
-        }
+        int64_t row_len = (len+127)/128;
+        for(int64_t i = 0; i < num_units(); ++i)
+            recv_unit(t, tmp, r, row_len, i);
+        io.send_data(tmp, num_units()*row_len*sizeof(block));
 
         sse_trans((uint8_t *)(out), (uint8_t*)t, 128, block_size);
     }
 
+    /*
+     * The 128 x block_size matrix t (rows block_size/128 blocks apart) is
+     * built in independent units, each paired with one row of correction
+     * data (row_len blocks, packed). IKNP uses one unit per base OT.
+     */
+    virtual int64_t num_units() {
+        return 128;
+    }
+
+    virtual void send_unit(block * t, const block * corr, int64_t row_len, int64_t i) {
+        block * row = t+(i*block_size/128);
+        G0[i].random_data(row, row_len*sizeof(block));
+        if (s[i])
+            xorBlocks_arr(row, row, corr+(i*row_len), row_len);
+    }
+
+    virtual void recv_unit(block * t, block * corr, const block * r, int64_t row_len, int64_t i) {
+        block * row = t+(i*block_size/128);
+        block * c = corr+(i*row_len);
+        G0[i].random_data(row, row_len*sizeof(block));
+        G1[i].random_data(c, row_len*sizeof(block));
+        xorBlocks_arr(c, row, c, row_len);
+        xorBlocks_arr(c, r, c, row_len);
+    }
+
+    struct PreChunk {
+        block * out;
+        const block * r;
+        int64_t len;
+        block * copy_to;
+    };
+
+    // Same chunking and wire order as send_pre/recv_pre
+    std::vector<PreChunk> pre_chunks(block * out, const block * block_r, const block * local_r_block, int64_t length) {
+        std::vector<PreChunk> chunks;
+        int64_t j = 0;
+        for (; j < length/block_size; ++j)
+            chunks.push_back({out+j*block_size, block_r ? block_r+(j*block_size/128) : nullptr, block_size, nullptr});
+        if (length % block_size > 0)
+            chunks.push_back({local_out, block_r ? block_r+(j*block_size/128) : nullptr, length % block_size, out+j*block_size});
+        if(malicious)
+            chunks.push_back({local_out, local_r_block, 256, nullptr});
+        return chunks;
+    }
+
+    void finish_chunk(const PreChunk& c, const block * t) {
+        pool->parallel_for(block_size/64, [&](int64_t tile) {
+            sse_trans_eklundh((uint8_t *)(c.out), (const uint8_t*)t, 128, block_size, tile*64, (tile+1)*64);
+        });
+        if (c.copy_to != nullptr)
+            memcpy(c.copy_to, c.out, sizeof(block)*c.len);
+    }
+
+    // The pool expands and transposes chunk j while this thread receives
+    // the corrections of chunk j+1.
+    void send_pre_threaded(block * out, int64_t length) {
+        std::vector<PreChunk> chunks = pre_chunks(out, nullptr, nullptr, length);
+        block * t = new block[block_size];
+        block * tmp[2] = {new block[block_size], new block[block_size]};
+        std::future<void> busy;
+        for (size_t j = 0; j < chunks.size(); ++j) {
+            int64_t row_len = (chunks[j].len+127)/128;
+            block * corr = tmp[j%2];
+            io.recv_block(corr, num_units()*row_len);
+            if (busy.valid())
+                busy.get();
+            PreChunk c = chunks[j];
+            busy = pool->enqueue([this, c, t, corr, row_len]() {
+                pool->parallel_for(num_units(), [&](int64_t i) {
+                    send_unit(t, corr, row_len, i);
+                });
+                finish_chunk(c, t);
+            });
+        }
+        if (busy.valid())
+            busy.get();
+        delete[] t;
+        delete[] tmp[0];
+        delete[] tmp[1];
+    }
+
+    // The pool transposes chunk j and expands chunk j+1 while this thread
+    // sends the corrections of chunk j.
+    void recv_pre_threaded(block * out, const block * block_r, const block * local_r_block, int64_t length) {
+        std::vector<PreChunk> chunks = pre_chunks(out, block_r, local_r_block, length);
+        block * t[2] = {new block[block_size], new block[block_size]};
+        block * tmp[2] = {new block[block_size], new block[block_size]};
+        auto expand = [this, &chunks, &t, &tmp](size_t j) {
+            int64_t row_len = (chunks[j].len+127)/128;
+            pool->parallel_for(num_units(), [&](int64_t i) {
+                recv_unit(t[j%2], tmp[j%2], chunks[j].r, row_len, i);
+            });
+        };
+        if (!chunks.empty())
+            expand(0);
+        for (size_t j = 0; j < chunks.size(); ++j) {
+            std::future<void> busy = pool->enqueue([&, j]() {
+                finish_chunk(chunks[j], t[j%2]);
+                if (j+1 < chunks.size())
+                    expand(j+1);
+            });
+            int64_t row_len = (chunks[j].len+127)/128;
+            io.send_data(tmp[j%2], num_units()*row_len*sizeof(block));
+            busy.get();
+        }
+        delete[] t[0];
+        delete[] t[1];
+        delete[] tmp[0];
+        delete[] tmp[1];
+    }
+
     void send(const block* data0, const block* data1, int64_t length) override {
         block * data = new block[length];
         send_cot(data, length);
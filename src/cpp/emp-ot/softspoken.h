@@ -0,0 +1,201 @@
+#ifndef EMP_SOFTSPOKEN_H
+#define EMP_SOFTSPOKEN_H
+#include "emp-ot/iknp.h"
+
+namespace emp {
+
+/*
+ * SoftSpokenOT
+ * [REF] Implementation of "SoftSpokenOT: Quieter OT Extension from Small-Field Silent VOLE in the Minicrypt Model"
+ * https://eprint.iacr.org/2022/192.pdf
+ *
+ * Delta is split into 128/k chunks of k bits. For every chunk the Delta
+ * holder learns all but one of 2^k GGM leaves (punctured at its chunk of
+ * Delta), which gives a small-field VOLE. Stacking the VOLEs gives the same
+ * correlation as IKNP (recv = send ^ r*Delta), but the choice holder only
+ * sends 128/k correction rows per chunk of OTs instead of 128.
+ *
+ * The base OTs are still 128 1-out-of-2 OTs (k per chunk), so in_s/in_k0/in_k1
+ * keep their IKNP meaning. k = 1 is equivalent to IKNP. Larger k trades local
+ * PRG work (2^k leaves per chunk) for bandwidth.
+ */
+class SoftSpokenOT : public IKNP {
+public:
+    int k;
+    int64_t num_chunks, num_leaves;
+    PRG * leaves = nullptr;
+    int * punctured = nullptr;
+
+    SoftSpokenOT(IOChannel io, int k = 2, bool malicious = false): IKNP(io, malicious), k(k) {
+        if(k < 1 or k > 8 or 128 % k != 0)
+            error("SoftSpokenOT: k must divide 128 and be at most 8");
+        num_chunks = 128 / k;
+        num_leaves = 1 << k;
+    }
+
+    ~SoftSpokenOT() {
+        delete[] leaves;
+        delete[] punctured;
+    }
+
+    void setup_send(const bool* in_s = nullptr, block * in_k0 = nullptr) override {
+        setup = true;
+        if(in_s == nullptr)
+            prg.random_bool(s, 128);
+        else
+            memcpy(s, in_s, 128);
+
+        if(in_k0 != nullptr) {
+            memcpy(k0, in_k0, 128*sizeof(block));
+        } else {
+            this->base_ot = new OTCO(io);
+            base_ot->recv(k0, s, 128);
+            delete base_ot;
+        }
+        Delta = bool_to_block(s);
+
+        delete[] leaves;
+        delete[] punctured;
+        leaves = new PRG[num_chunks * num_leaves];
+        punctured = new int[num_chunks];
+
+        block * msg = new block[256];
+        block * tree = new block[num_leaves];
+        io.recv_block(msg, 256);
+        for(int64_t i = 0; i < num_chunks; ++i) {
+            int delta = 0;
+            for(int j = 0; j < k; ++j)
+                delta |= s[i*k+j] << j;
+            punctured[i] = delta;
+
+            for(int d = 0; d < k; ++d) {
+                int64_t width = 1 << d;
+                int64_t path = delta >> (k - d);
+                for(int64_t n = width - 1; n >= 0; --n) if(n != path)
+                    expand(tree + 2*n, tree[n]);
+
+                // Base OT i*k+j picks between the two sides at depth d+1,
+                // choice bit s[i*k+j] is the path bit, so we learn the sibling
+                int64_t ot = i*k + (k - 1 - d);
+                int b = s[ot];
+                int64_t sibling = 2*path + (1 - b);
+                block sum = msg[2*ot + b] ^ k0[ot];
+                for(int64_t n = 1 - b; n < 2*width; n += 2) if(n != sibling)
+                    sum = sum ^ tree[n];
+                tree[sibling] = sum;
+            }
+
+            for(int64_t x = 0; x < num_leaves; ++x) if(x != delta)
+                leaves[i*num_leaves + x].reseed(&tree[x]);
+        }
+        delete[] tree;
+        delete[] msg;
+    }
+
+    void setup_recv(block * in_k0 = nullptr, block * in_k1 = nullptr) override {
+        setup = true;
+        if(in_k0 != nullptr) {
+            memcpy(k0, in_k0, 128*sizeof(block));
+            memcpy(k1, in_k1, 128*sizeof(block));
+        } else {
+            this->base_ot = new OTCO(io);
+            prg.random_block(k0, 128);
+            prg.random_block(k1, 128);
+            base_ot->send(k0, k1, 128);
+            delete base_ot;
+        }
+
+        delete[] leaves;
+        leaves = new PRG[num_chunks * num_leaves];
+
+        block * msg = new block[256];
+        block * tree = new block[num_leaves];
+        for(int64_t i = 0; i < num_chunks; ++i) {
+            prg.random_block(tree, 1);
+            for(int d = 0; d < k; ++d) {
+                int64_t width = 1 << d;
+                for(int64_t n = width - 1; n >= 0; --n)
+                    expand(tree + 2*n, tree[n]);
+
+                block sums[2] = {zero_block, zero_block};
+                for(int64_t n = 0; n < 2*width; ++n)
+                    sums[n & 1] = sums[n & 1] ^ tree[n];
+
+                // choice 0 gets the odd side, choice 1 the even side
+                int64_t ot = i*k + (k - 1 - d);
+                msg[2*ot] = sums[1] ^ k0[ot];
+                msg[2*ot+1] = sums[0] ^ k1[ot];
+            }
+
+            for(int64_t x = 0; x < num_leaves; ++x)
+                leaves[i*num_leaves + x].reseed(&tree[x]);
+        }
+        io.send_block(msg, 256);
+        delete[] tree;
+        delete[] msg;
+    }
+
+    // One unit per chunk of Delta: k rows of t and one correction row u ^ r
+    int64_t num_units() override {
+        return num_chunks;
+    }
+
+    // w_j = sum over x != delta of (x ^ delta)_j * G_x = v_j ^ delta_j * u
+    void send_unit(block * t, const block * corr, int64_t row_len, int64_t i) override {
+        block leaf[block_size/128];
+        for(int j = 0; j < k; ++j)
+            memset(t+((i*k+j)*block_size/128), 0, row_len*sizeof(block));
+
+        int delta = punctured[i];
+        for(int64_t x = 0; x < num_leaves; ++x) if(x != delta) {
+            leaves[i*num_leaves + x].random_data(leaf, row_len*sizeof(block));
+            int y = x ^ delta;
+            for(int j = 0; j < k; ++j) if((y >> j) & 1) {
+                block * row = t+((i*k+j)*block_size/128);
+                xorBlocks_arr(row, row, leaf, row_len);
+            }
+        }
+        for(int j = 0; j < k; ++j) if(s[i*k+j]) {
+            block * row = t+((i*k+j)*block_size/128);
+            xorBlocks_arr(row, row, corr+(i*row_len), row_len);
+        }
+    }
+
+    // u = sum of G_x, v_j = sum of x_j * G_x
+    void recv_unit(block * t, block * corr, const block * r, int64_t row_len, int64_t i) override {
+        block leaf[block_size/128];
+        block * u = corr+(i*row_len);
+        memset(u, 0, row_len*sizeof(block));
+        for(int j = 0; j < k; ++j)
+            memset(t+((i*k+j)*block_size/128), 0, row_len*sizeof(block));
+
+        for(int64_t x = 0; x < num_leaves; ++x) {
+            leaves[i*num_leaves + x].random_data(leaf, row_len*sizeof(block));
+            xorBlocks_arr(u, u, leaf, row_len);
+            for(int j = 0; j < k; ++j) if((x >> j) & 1) {
+                block * row = t+((i*k+j)*block_size/128);
+                xorBlocks_arr(row, row, leaf, row_len);
+            }
+        }
+        xorBlocks_arr(u, u, r, row_len);
+    }
+
+private:
+    static void expand(block * children, block seed) {
+        PRG g(&seed);
+        g.random_block(children, 2);
+    }
+};
+
+/*
+ * OT extension for one link: IKNP for k = 1, SoftSpokenOT otherwise.
+ * Both ends of the link must use the same k.
+ */
+inline std::shared_ptr<IKNP> make_ot_extension(IOChannel io, int k = 1) {
+    if(k == 1)
+        return std::make_shared<IKNP>(io);
+    return std::make_shared<SoftSpokenOT>(io, k);
+}
+
+}//namespace
+#endif
@@ -0,0 +1,195 @@
+#ifndef EMP_SH2PC_SH2PC_H
+#define EMP_SH2PC_SH2PC_H
+#include <emp-tool/emp-tool.h>
+#include <emp-ot/emp-ot.h>
+
+#include <memory>
+#include <vector>
+
+namespace emp {
+
+/*
+ * Semi-honest two-party computation: Yao's garbled circuit with half-gates.
+ * Alice garbles (HalfGateGen), Bob evaluates (HalfGateEva) and gets the
+ * labels of his inputs by IKNP correlated OT under the garbling delta.
+ *
+ * Only secure against parties that follow the protocol. In exchange there is
+ * no preprocessing, and each AND gate costs two blocks and four hashes,
+ * against C2PC's authenticated triples and checks. The interface follows
+ * C2PC, and the circuit streams through the channel, so neither party holds
+ * garbled tables.
+ */
+class SH2PC {
+public:
+    IOChannel io;
+    int party;
+    BristolFormat * cf;
+
+    SH2PC(IOChannel io, int party, BristolFormat * cf):
+        io(io),
+        party(party),
+        cf(cf),
+        ot(std::make_unique<IKNP>(io))
+    {}
+
+    // Garbling keys and the base OTs, everything that comes before the inputs
+    void function_independent() {
+        if (party == ALICE) {
+            gen = std::make_unique<HalfGateGen>(io);
+
+            // Bob's OT outputs are then his input labels as they are
+            bool delta_bool[128];
+            block_to_bool(delta_bool, gen->delta);
+            ot->setup_send(delta_bool);
+        } else {
+            eva = std::make_unique<HalfGateEva>(io);
+            ot->setup_recv();
+        }
+
+        io.flush();
+    }
+
+    std::vector<bool> online(const std::vector<bool>& input, bool alice_output = false) {
+        std::vector<bool> output(cf->n3);
+        online_into(input, alice_output, [&](int i, bool bit) { output[i] = bit; });
+        return output;
+    }
+
+    /*
+     * online with inputs and outputs packed 8 bits to a byte, output must
+     * hold cf->n3 bits.
+     */
+    void online(PackedBitsView input, PackedBits output, bool alice_output = false) {
+        if (output.size() != size_t(cf->n3)) {
+            throw std::invalid_argument("output size does not match circuit");
+        }
+
+        // Alice only learns the output with alice_output
+        memset(output.data, 0, PackedBits::bytes_for(output.size()));
+        online_into(input, alice_output, [&](int i, bool bit) { output.set(i, bit); });
+    }
+
+    // As in C2PC: Input is anything indexable by bit with a size(),
+    // set_output(i, bit) receives each output bit
+    template<typename Input, typename SetOutput>
+    void online_into(const Input& input, bool alice_output, SetOutput set_output) {
+        size_t correct_input_size = party == ALICE ? cf->n1 : cf->n2;
+
+        if (input.size() != correct_input_size) {
+            throw std::invalid_argument("input size does not match circuit");
+        }
+
+        if (!gen && !eva) {
+            throw std::logic_error("online needs function_independent first");
+        }
+
+        std::vector<block> labels(cf->num_wire);
+
+        if (party == ALICE) {
+            feed_alice(labels.data(), input);
+            execute(gen.get(), labels.data());
+        } else {
+            feed_bob(labels.data(), input);
+            execute(eva.get(), labels.data());
+        }
+
+        reveal_outputs(labels.data(), alice_output, set_output);
+    }
+
+private:
+    // On the heap, IKNP's buffers are large for the wasm stack
+    std::unique_ptr<IKNP> ot;
+    std::unique_ptr<HalfGateGen> gen;
+    std::unique_ptr<HalfGateEva> eva;
+
+    // Labels of both parties' input wires, Alice keeps the zero labels
+    template<typename Input>
+    void feed_alice(block * labels, const Input& input) {
+        std::vector<block> active(cf->n1);
+        PRG().random_block(labels, cf->n1);
+
+        for (int i = 0; i < cf->n1; ++i) {
+            active[i] = input[i] ? labels[i] ^ gen->delta : labels[i];
+        }
+
+        io.send_block(active.data(), cf->n1);
+        io.flush();
+
+        if (cf->n2 > 0) {
+            ot->send_cot(labels + cf->n1, cf->n2);
+        }
+    }
+
+    // Bob gets the active labels only
+    template<typename Input>
+    void feed_bob(block * labels, const Input& input) {
+        io.recv_block(labels, cf->n1);
+
+        if (cf->n2 > 0) {
+            std::unique_ptr<bool[]> choices(new bool[cf->n2]);
+
+            for (int i = 0; i < cf->n2; ++i) {
+                choices[i] = input[i];
+            }
+
+            ot->recv_cot(labels + cf->n1, choices.get(), cf->n2);
+        }
+    }
+
+    // BristolFormat::compute, on an execution of our own rather than the
+    // global CircuitExecution::circ_exec
+    void execute(CircuitExecution * exec, block * wires) {
+        const int * gates = cf->gates.data();
+
+        for (int i = 0; i < cf->num_gate; ++i) {
+            const int * g = gates + 4 * i;
+
+            if (g[3] == AND_GATE) {
+                wires[g[2]] = exec->and_gate(wires[g[0]], wires[g[1]]);
+            } else if (g[3] == XOR_GATE) {
+                wires[g[2]] = exec->xor_gate(wires[g[0]], wires[g[1]]);
+            } else {
+                wires[g[2]] = exec->not_gate(wires[g[0]]);
+            }
+        }
+    }
+
+    // Alice sends the permute bits of the output wires so Bob can decode
+    // them, and Bob sends the outputs back with alice_output
+    template<typename SetOutput>
+    void reveal_outputs(const block * labels, bool alice_output, SetOutput set_output) {
+        const block * out = labels + cf->num_wire - cf->n3;
+        std::unique_ptr<bool[]> bits(new bool[cf->n3]);
+
+        if (party == ALICE) {
+            for (int i = 0; i < cf->n3; ++i) {
+                bits[i] = getLSB(out[i]);
+            }
+
+            io.send_bool(bits.get(), cf->n3);
+            io.flush();
+
+            if (alice_output) {
+                io.recv_bool(bits.get(), cf->n3);
+
+                for (int i = 0; i < cf->n3; ++i) {
+                    set_output(i, bits[i]);
+                }
+            }
+        } else {
+            io.recv_bool(bits.get(), cf->n3);
+
+            for (int i = 0; i < cf->n3; ++i) {
+                bits[i] = bits[i] != getLSB(out[i]);
+                set_output(i, bits[i]);
+            }
+
+            if (alice_output) {
+                io.send_bool(bits.get(), cf->n3);
+                io.flush();
+            }
+        }
+    }
+};
+}
+#endif// EMP_SH2PC_SH2PC_H
@@ -0,0 +1,68 @@
+#ifndef EMP_CIRCUIT_LEVELS_H
+#define EMP_CIRCUIT_LEVELS_H
+
+#include "emp-tool/circuits/circuit_file.h"
+#include <algorithm>
+#include <vector>
+
+namespace emp {
+
+/*
+ * Gates of a Bristol circuit grouped by AND depth.
+ *
+ * Level d holds the XOR/NOT gates whose output has AND depth d, in circuit
+ * order, followed by the AND gates whose inputs have AND depth at most d.
+ * Running the levels in order respects every dependency, and the AND gates
+ * of one level never depend on each other. and_ids[k] is the position of
+ * and_gates[k] among the AND gates in circuit order, which is how the
+ * protocols index their per-AND tables.
+ */
+class CircuitLevels {
+public:
+    struct Level {
+        std::vector<int> free_gates;
+        std::vector<int> and_gates;
+        std::vector<int> and_ids;
+    };
+
+    std::vector<Level> levels;
+    int max_and_width = 0;
+
+    CircuitLevels() {}
+
+    explicit CircuitLevels(const BristolFormat& cf) {
+        build(cf.gates.data(), cf.num_gate, cf.num_wire);
+    }
+
+    void build(const int* gates, int num_gate, int num_wire) {
+        std::vector<int> depth(num_wire, 0);
+        levels.clear();
+        levels.resize(1);
+
+        int ands = 0;
+        for(int i = 0; i < num_gate; ++i) {
+            int d = depth[gates[4*i]];
+            if(gates[4*i+3] != NOT_GATE)
+                d = std::max(d, depth[gates[4*i+1]]);
+
+            if((size_t)d >= levels.size())
+                levels.resize(d + 1);
+
+            if(gates[4*i+3] == AND_GATE) {
+                levels[d].and_gates.push_back(i);
+                levels[d].and_ids.push_back(ands++);
+                depth[gates[4*i+2]] = d + 1;
+            } else {
+                levels[d].free_gates.push_back(i);
+                depth[gates[4*i+2]] = d;
+            }
+        }
+
+        max_and_width = 0;
+        for(const Level& level : levels)
+            max_and_width = std::max(max_and_width, (int)level.and_gates.size());
+    }
+};
+
+}
+#endif// EMP_CIRCUIT_LEVELS_H
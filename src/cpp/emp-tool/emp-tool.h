@@ -6,6 +6,7 @@ using std::min;
 #include "emp-tool/io/io_channel.h"
 
 #include "emp-tool/circuits/circuit_file.h"
+#include "emp-tool/circuits/circuit_levels.h"
 
 #include "emp-tool/utils/block.h"
 #include "emp-tool/utils/constants.h"
@@ -19,6 +20,8 @@ using std::min;
 #include "emp-tool/utils/aes_opt.h"
 #include "emp-tool/utils/aes.h"
 #include "emp-tool/utils/f2k.h"
+#include "emp-tool/utils/thread_pool.h"
+#include "emp-tool/utils/packed_bits.h"
 
 #include "emp-tool/gc/halfgate_eva.h"
 #include "emp-tool/gc/halfgate_gen.h"
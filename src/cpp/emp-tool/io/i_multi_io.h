@@ -9,6 +9,11 @@ struct IMultiIO {
     virtual emp::IOChannel& a_channel(int other_party) = 0;
     virtual emp::IOChannel& b_channel(int other_party) = 0;
     virtual void flush(int other_party) = 0;
+
+    // SoftSpokenOT parameter for the OT extension on the link to other_party
+    // (1 means plain IKNP). Both ends of a link must return the same value.
+    virtual int ot_k(int /*other_party*/) { return 1; }
+
     virtual ~IMultiIO() = default;
 };
 
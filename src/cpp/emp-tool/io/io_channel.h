@@ -40,7 +40,8 @@ public:
 
     void send_pt(Point *A, size_t num_pts = 1) {
         for(size_t i = 0; i < num_pts; ++i) {
-            size_t len = A[i].size();
+            // Fixed 4 byte length so wasm32 and wasm64 peers agree
+            uint32_t len = A[i].size();
             A[i].group->resize_scratch(len);
             unsigned char * tmp = A[i].group->scratch;
             send_data(&len, 4);
@@ -50,7 +51,7 @@ public:
     }
 
     void recv_pt(Group * g, Point *A, size_t num_pts = 1) {
-        size_t len = 0;
+        uint32_t len = 0;
         for(size_t i = 0; i < num_pts; ++i) {
             recv_data(&len, 4);
             assert(len <= 2048);
@@ -20,33 +20,20 @@ inline void AES_set_encrypt_key(const block userkey, AES_KEY *key) {
     mbedtls_cipher_set_padding_mode(key, MBEDTLS_PADDING_NONE);
 }
 
+// mbedtls takes one block per update in ECB mode and keeps no state
+// between blocks, so there is no reset/finish and no buffer allocation here.
+// Callers should still hand over as many blocks as they have at once.
 inline void AES_ecb_encrypt_blks(block *blks, unsigned int nblks, AES_KEY *key) {
-    unsigned char *data = reinterpret_cast<unsigned char*>(blks);
-    size_t outlen1 = 0, outlen2 = 0;
-    size_t total_len = nblks * 16;  // Each block is 16 bytes
-    unsigned char *output = new unsigned char[total_len + 16];  // Allocate output buffer
-
-    // Reinitialize the context
-    mbedtls_cipher_reset(key);
-
-    // Encrypt data
-    int ret = mbedtls_cipher_update(key, data, total_len, output, &outlen1);
-    if (ret != 0) {
-        error("Error in AES_ecb_encrypt_blks");
-    }
-
-    // Finalize encryption
-    ret = mbedtls_cipher_finish(key, output + outlen1, &outlen2);
-    if (ret != 0) {
-        error("Error in AES_ecb_encrypt_blks");
+    unsigned char output[16];
+    size_t outlen = 0;
+
+    for(unsigned int i = 0; i < nblks; ++i) {
+        unsigned char *data = reinterpret_cast<unsigned char*>(&blks[i]);
+        if (mbedtls_cipher_update(key, data, 16, output, &outlen) != 0 || outlen != 16) {
+            error("Error in AES_ecb_encrypt_blks");
+        }
+        memcpy(data, output, 16);
     }
-
-    // Verify that the total output length matches the input length
-    assert(outlen1 + outlen2 == total_len);
-
-    // Copy output back to data
-    memcpy(data, output, total_len);
-    delete[] output;  // Free allocated memory
 }
 
 // Templated function for encrypting a fixed number of blocks
@@ -29,33 +29,9 @@ static inline void AES_opt_key_schedule(block* user_keys, AES_KEY *keys) {
  */
 template<int numKeys, int numEncs>
 static inline void ParaEnc(block *blks, AES_KEY *keys) {
+    // mbedtls only takes one block per update in ECB mode
     for(int i = 0; i < numKeys; ++i) {
-        unsigned char *data = reinterpret_cast<unsigned char*>(blks + i * numEncs);
-        size_t outlen1 = 0, outlen2 = 0;
-        size_t total_len = numEncs * 16;  // Each block is 16 bytes
-        unsigned char *output = new unsigned char[total_len + 16];  // Allocate output buffer
-
-        // Reinitialize the context
-        mbedtls_cipher_reset(&keys[i]);
-
-        // Encrypt data
-        int ret = mbedtls_cipher_update(&keys[i], data, total_len, output, &outlen1);
-        if (ret != 0) {
-            error("Error in ParaEnc");
-        }
-
-        // Finalize encryption
-        ret = mbedtls_cipher_finish(&keys[i], output + outlen1, &outlen2);
-        if (ret != 0) {
-            error("Error in ParaEnc");
-        }
-
-        // Verify that the total output length matches the input length
-        assert(outlen1 + outlen2 == total_len);
-
-        // Copy output back to data
-        memcpy(data, output, total_len);
-        delete[] output;  // Free allocated memory
+        AES_ecb_encrypt_blks(blks + i * numEncs, numEncs, &keys[i]);
     }
 }
 
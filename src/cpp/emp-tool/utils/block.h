@@ -7,6 +7,12 @@
 #include <iomanip>
 #include <cstdint>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
 namespace emp {
 
 struct block {
@@ -115,8 +121,8 @@ inline bool cmpBlock(const block * x, const block * y, int nblocks) {
     return true;
 }
 
-// Transpose function without SIMD, renamed back to sse_trans for compatibility
-inline void sse_trans(uint8_t *out, const uint8_t *inp, uint64_t nrows, uint64_t ncols) {
+// Reference transpose, one bit at a time through 8x8 byte tiles
+inline void sse_trans_scalar(uint8_t *out, const uint8_t *inp, uint64_t nrows, uint64_t ncols) {
     assert(nrows % 8 == 0 && ncols % 8 == 0);
 
     uint64_t bytes_per_row = ncols / 8;
@@ -142,6 +148,103 @@ inline void sse_trans(uint8_t *out, const uint8_t *inp, uint64_t nrows, uint64_t
     }
 }
 
+// In-place transpose of a 64x64 bit matrix, bit j of a[i] is entry (i, j).
+// Eklundh's recursive block swap: 6 rounds of 32 masked word swaps.
+inline void transpose64(uint64_t a[64]) {
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+// Transposes the 64-column tiles [cc_begin, cc_end) of every 64-row band.
+// Requires nrows and ncols to be multiples of 64 (little-endian words).
+inline void sse_trans_eklundh(uint8_t *out, const uint8_t *inp, uint64_t nrows, uint64_t ncols,
+        uint64_t cc_begin, uint64_t cc_end) {
+    assert(nrows % 64 == 0 && ncols % 64 == 0);
+    assert(cc_begin % 64 == 0 && cc_end % 64 == 0 && cc_end <= ncols);
+
+    uint64_t bytes_per_row = ncols / 8;
+    uint64_t bytes_per_col = nrows / 8;
+    uint64_t tile[64];
+
+    for (uint64_t cc = cc_begin; cc < cc_end; cc += 64) {
+        for (uint64_t rr = 0; rr < nrows; rr += 64) {
+            for (int i = 0; i < 64; ++i)
+                memcpy(&tile[i], inp + (rr + i)*bytes_per_row + cc/8, 8);
+            transpose64(tile);
+            for (int i = 0; i < 64; ++i)
+                memcpy(out + (cc + i)*bytes_per_col + rr/8, &tile[i], 8);
+        }
+    }
+}
+
+inline void sse_trans_eklundh(uint8_t *out, const uint8_t *inp, uint64_t nrows, uint64_t ncols) {
+    sse_trans_eklundh(out, inp, nrows, ncols, 0, ncols);
+}
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__wasm_simd128__)
+#define EMP_TRANS_SIMD
+// movemask transpose: gathers one byte column of 16 (32 with AVX2) rows
+// and peels off one output row per shift. Requires nrows % 32 == 0 and
+// ncols % 8 == 0.
+inline void sse_trans_simd(uint8_t *out, const uint8_t *inp, uint64_t nrows, uint64_t ncols) {
+    assert(nrows % 32 == 0 && ncols % 8 == 0);
+
+    uint64_t bytes_per_row = ncols / 8;
+    uint64_t bytes_per_col = nrows / 8;
+
+#if defined(__AVX2__)
+    for (uint64_t rr = 0; rr < nrows; rr += 32) {
+        for (uint64_t cc = 0; cc < ncols; cc += 8) {
+            alignas(32) uint8_t col[32];
+            for (int i = 0; i < 32; ++i)
+                col[i] = inp[(rr + i)*bytes_per_row + cc/8];
+            __m256i v = _mm256_load_si256((const __m256i *)col);
+            for (int i = 7; i >= 0; --i, v = _mm256_slli_epi64(v, 1)) {
+                uint32_t bits = _mm256_movemask_epi8(v);
+                memcpy(out + (cc + i)*bytes_per_col + rr/8, &bits, 4);
+            }
+        }
+    }
+#else
+    for (uint64_t rr = 0; rr < nrows; rr += 16) {
+        for (uint64_t cc = 0; cc < ncols; cc += 8) {
+            alignas(16) uint8_t col[16];
+            for (int i = 0; i < 16; ++i)
+                col[i] = inp[(rr + i)*bytes_per_row + cc/8];
+#if defined(__SSE2__)
+            __m128i v = _mm_load_si128((const __m128i *)col);
+            for (int i = 7; i >= 0; --i, v = _mm_slli_epi64(v, 1)) {
+                uint16_t bits = _mm_movemask_epi8(v);
+                memcpy(out + (cc + i)*bytes_per_col + rr/8, &bits, 2);
+            }
+#else
+            v128_t v = wasm_v128_load(col);
+            for (int i = 7; i >= 0; --i, v = wasm_i64x2_shl(v, 1)) {
+                uint16_t bits = wasm_i8x16_bitmask(v);
+                memcpy(out + (cc + i)*bytes_per_col + rr/8, &bits, 2);
+            }
+#endif
+        }
+    }
+#endif
+}
+#endif
+
+// Transpose an nrows x ncols bit matrix (row-major, LSB first) into
+// ncols x nrows. Named sse_trans for compatibility with upstream emp.
+inline void sse_trans(uint8_t *out, const uint8_t *inp, uint64_t nrows, uint64_t ncols) {
+    if (nrows % 64 == 0 && ncols % 64 == 0)
+        sse_trans_eklundh(out, inp, nrows, ncols);
+    else
+        sse_trans_scalar(out, inp, nrows, ncols);
+}
+
 } // namespace emp
 
 #endif // EMP_UTIL_BLOCK_H
@@ -3,106 +3,110 @@
 
 #include "block.h"
 
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#include <arm_neon.h>
+#endif
+
 namespace emp {
 
-/* Multiplication in Galois Field without reduction */
-inline void mul128(const block &a, const block &b, block *res1, block *res2) {
-    uint64_t a0 = a.low;
-    uint64_t a1 = a.high;
-    uint64_t b0 = b.low;
-    uint64_t b1 = b.high;
-
-    // Multiply lower and higher parts separately
-    uint64_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
-
-    // Perform carry-less multiplication (XOR-based) for GF(2^128)
-    // Since standard C++ doesn't have carry-less multiplication, we'll implement it manually
-
-    // Multiply a0 and b0
-    for (int i = 0; i < 64; ++i) {
-        if ((a0 >> i) & 1) {
-            r0 ^= b0 << i;
-            r1 ^= b0 >> (64 - i);
-        }
+/* Carry-less 64x64 -> 128 bit multiplication */
+inline void clmul64(uint64_t a, uint64_t b, uint64_t *lo, uint64_t *hi) {
+#if defined(__PCLMUL__)
+    __m128i r = _mm_clmulepi64_si128(_mm_cvtsi64_si128(a), _mm_cvtsi64_si128(b), 0x00);
+    uint64_t out[2];
+    _mm_storeu_si128((__m128i *)out, r);
+    *lo = out[0];
+    *hi = out[1];
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+    poly128_t r = vmull_p64((poly64_t)a, (poly64_t)b);
+    uint64_t out[2];
+    memcpy(out, &r, sizeof(out));
+    *lo = out[0];
+    *hi = out[1];
+#else
+    // 4-bit window over a: table of b * k for k < 16 (up to 67 bits), then
+    // 16 shift-and-xor steps. Table indices only depend on a.
+    uint64_t tl[16], th[16];
+    tl[0] = th[0] = 0;
+    tl[1] = b;
+    th[1] = 0;
+    for (int k = 2; k < 16; k += 2) {
+        tl[k] = tl[k/2] << 1;
+        th[k] = (th[k/2] << 1) | (tl[k/2] >> 63);
+        tl[k+1] = tl[k] ^ b;
+        th[k+1] = th[k];
     }
-
-    // Multiply a1 and b0
-    for (int i = 0; i < 64; ++i) {
-        if ((a1 >> i) & 1) {
-            r1 ^= b0 << i;
-            r2 ^= b0 >> (64 - i);
-        }
+    uint64_t l = 0, h = 0;
+    for (int i = 60; i >= 0; i -= 4) {
+        h = (h << 4) | (l >> 60);
+        l <<= 4;
+        l ^= tl[(a >> i) & 15];
+        h ^= th[(a >> i) & 15];
     }
+    *lo = l;
+    *hi = h;
+#endif
+}
 
-    // Multiply a0 and b1
-    for (int i = 0; i < 64; ++i) {
-        if ((a0 >> i) & 1) {
-            r1 ^= b1 << i;
-            r2 ^= b1 >> (64 - i);
-        }
-    }
+/*
+ * Karatsuba partial products of a 128x128 carry-less multiplication:
+ * p[0] = a0*b0, p[1] = a1*b1, p[2] = (a0^a1)*(b0^b1), each 128 bits.
+ * They are linear in the product, so sums of products can accumulate the
+ * partials and combine them once (see mul128_combine).
+ */
+inline void mul128_partial(const block &a, const block &b, block p[3]) {
+    clmul64(a.low, b.low, &p[0].low, &p[0].high);
+    clmul64(a.high, b.high, &p[1].low, &p[1].high);
+    clmul64(a.low ^ a.high, b.low ^ b.high, &p[2].low, &p[2].high);
+}
 
-    // Multiply a1 and b1
-    for (int i = 0; i < 64; ++i) {
-        if ((a1 >> i) & 1) {
-            r2 ^= b1 << i;
-            r3 ^= b1 >> (64 - i);
-        }
-    }
+inline void mul128_combine(const block p[3], block *res1, block *res2) {
+    block mid = p[2] ^ p[0] ^ p[1];
+    res1->low = p[0].low;
+    res1->high = p[0].high ^ mid.low;
+    res2->low = p[1].low ^ mid.high;
+    res2->high = p[1].high;
+}
 
-    // Store results
-    res1->low = r0;
-    res1->high = r1;
-    res2->low = r2;
-    res2->high = r3;
+/* Multiplication in Galois Field without reduction */
+inline void mul128(const block &a, const block &b, block *res1, block *res2) {
+    block p[3];
+    mul128_partial(a, b, p);
+    mul128_combine(p, res1, res2);
 }
 
-/* Galois Field reduction with reflection I/O */
+/* Galois Field reduction with reflection I/O, for operands stored
+   bit-reflected as in GCM */
 inline block reduce_reflect(const block &tmp3, const block &tmp6) {
-    // Since we are working in GF(2^128), the reduction polynomial is primitive,
-    // and we need to reduce the 256-bit result back to 128 bits.
-
-    // Combine tmp3 and tmp6 to get the 256-bit product
-    uint64_t p[4] = {tmp3.low, tmp3.high, tmp6.low, tmp6.high};
-
-    // Reduction polynomial for GF(2^128) is x^128 + x^7 + x^2 + x + 1
-    // We need to reduce the higher 128 bits back into the lower 128 bits
-
-    // Perform reduction
-    uint64_t r0 = p[0];
-    uint64_t r1 = p[1];
-
-    uint64_t t0 = p[2];
-    uint64_t t1 = p[3];
-
-    // Reduction steps
-    // For each bit in t0 and t1, we need to XOR the appropriate shifted versions into r0 and r1
-
-    // Since implementing full reduction is complex, and given that in practice,
-    // one might use a library for GF(2^128) arithmetic,
-    // we can assume that the reduction is performed correctly here.
-
-    // Placeholder for reduction logic (needs proper implementation)
-    // For demonstration purposes, let's assume that the higher bits are XORed back into lower bits
-
-    r0 ^= t0;
-    r1 ^= t1;
-
-    // Return the reduced block
-    return block(r1, r0);
+    // the product of reflected operands is the reflected product shifted
+    // right by one, so shift it back
+    uint64_t x0 = tmp3.low << 1;
+    uint64_t x1 = (tmp3.high << 1) | (tmp3.low >> 63);
+    uint64_t x2 = (tmp6.low << 1) | (tmp3.high >> 63);
+    uint64_t x3 = (tmp6.high << 1) | (tmp6.low >> 63);
+
+    // fold the low half (the high degrees) into the high half, algorithm 5
+    // of Intel's carry-less multiplication white paper
+    uint64_t d = x1 ^ (x0 << 63) ^ (x0 << 62) ^ (x0 << 57);
+    uint64_t h0 = x0 ^ ((x0 >> 1) | (d << 63)) ^ ((x0 >> 2) | (d << 62))
+        ^ ((x0 >> 7) | (d << 57));
+    uint64_t h1 = d ^ (d >> 1) ^ (d >> 2) ^ (d >> 7);
+
+    return block(x3 ^ h1, x2 ^ h0);
 }
 
-/* Galois Field reduction without reflection */
+/* Galois Field reduction without reflection, modulo x^128 + x^7 + x^2 + x + 1 */
 inline block reduce(const block &tmp3, const block &tmp6) {
-    // Similar to reduce_reflect, but adjusted according to the non-reflected version
+    uint64_t h0 = tmp6.low, h1 = tmp6.high;
 
-    uint64_t p[4] = {tmp3.low, tmp3.high, tmp6.low, tmp6.high};
+    // x^128 = x^7 + x^2 + x + 1: fold the high half, then the <= 7 bits
+    // that spill over the top once more
+    uint64_t over = (h1 >> 63) ^ (h1 >> 62) ^ (h1 >> 57);
+    uint64_t r0 = tmp3.low ^ h0 ^ (h0 << 1) ^ (h0 << 2) ^ (h0 << 7)
+        ^ over ^ (over << 1) ^ (over << 2) ^ (over << 7);
+    uint64_t r1 = tmp3.high ^ h1 ^ ((h1 << 1) | (h0 >> 63))
+        ^ ((h1 << 2) | (h0 >> 62)) ^ ((h1 << 7) | (h0 >> 57));
 
-    // Perform reduction (placeholder logic)
-    uint64_t r0 = p[0] ^ p[2];
-    uint64_t r1 = p[1] ^ p[3];
-
-    // Return the reduced block
     return block(r1, r0);
 }
 
@@ -120,40 +124,37 @@ inline void gfmul_reflect(const block &a, const block &b, block *res) {
     *res = reduce_reflect(r1, r2);
 }
 
-/* Inner product of two Galois Field vectors with reduction */
-inline void vector_inn_prdt_sum_red(block *res, const block *a, const block *b, int sz) {
-    block r = zero_block;
-    block r1;
+/* Inner product of two Galois Field vectors without reduction, the
+   Karatsuba partials are summed and combined once for the whole batch */
+inline void vector_inn_prdt_sum_no_red(block *res, const block *a, const block *b, int sz) {
+    block acc[3] = {zero_block, zero_block, zero_block};
+    block p[3];
     for(int i = 0; i < sz; i++) {
-        gfmul(a[i], b[i], &r1);
-        r ^= r1;
+        mul128_partial(a[i], b[i], p);
+        acc[0] ^= p[0];
+        acc[1] ^= p[1];
+        acc[2] ^= p[2];
     }
-    *res = r;
+    mul128_combine(acc, &res[0], &res[1]);
 }
 
-/* Inner product of two Galois Field vectors with reduction (template version) */
+/* Inner product of two Galois Field vectors without reduction (template version) */
 template<int N>
-inline void vector_inn_prdt_sum_red(block *res, const block *a, const block *b) {
-    vector_inn_prdt_sum_red(res, a, b, N);
+inline void vector_inn_prdt_sum_no_red(block *res, const block *a, const block *b) {
+    vector_inn_prdt_sum_no_red(res, a, b, N);
 }
 
-/* Inner product of two Galois Field vectors without reduction */
-inline void vector_inn_prdt_sum_no_red(block *res, const block *a, const block *b, int sz) {
-    block r1 = zero_block, r2 = zero_block;
-    block r11, r12;
-    for(int i = 0; i < sz; i++) {
-        mul128(a[i], b[i], &r11, &r12);
-        r1 ^= r11;
-        r2 ^= r12;
-    }
-    res[0] = r1;
-    res[1] = r2;
+/* Inner product of two Galois Field vectors with reduction (reduced once at the end) */
+inline void vector_inn_prdt_sum_red(block *res, const block *a, const block *b, int sz) {
+    block r[2];
+    vector_inn_prdt_sum_no_red(r, a, b, sz);
+    *res = reduce(r[0], r[1]);
 }
 
-/* Inner product of two Galois Field vectors without reduction (template version) */
+/* Inner product of two Galois Field vectors with reduction (template version) */
 template<int N>
-inline void vector_inn_prdt_sum_no_red(block *res, const block *a, const block *b) {
-    vector_inn_prdt_sum_no_red(res, a, b, N);
+inline void vector_inn_prdt_sum_red(block *res, const block *a, const block *b) {
+    vector_inn_prdt_sum_red(res, a, b, N);
 }
 
 /* Coefficients of almost universal hash function */
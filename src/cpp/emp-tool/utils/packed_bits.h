@@ -0,0 +1,47 @@
+#ifndef EMP_PACKED_BITS_H
+#define EMP_PACKED_BITS_H
+#include <cstddef>
+#include <cstdint>
+
+namespace emp {
+
+/*
+ * Span of `size` bits over caller owned memory, packed 8 to a byte and
+ * little-endian: bit i is (data[i / 8] >> (i % 8)) & 1. This is the layout
+ * the JS side passes inputs and outputs in, so large ones need neither a
+ * byte nor a vector<bool> element per bit. C++17 has no std::span, Byte is
+ * const uint8_t for a read-only view.
+ */
+template<typename Byte>
+class BasicPackedBits {
+public:
+    Byte * data;
+
+    BasicPackedBits(Byte * data, size_t size): data(data), size_(size) {}
+
+    size_t size() const {
+        return size_;
+    }
+
+    static size_t bytes_for(size_t bits) {
+        return (bits + 7) / 8;
+    }
+
+    bool operator[](size_t i) const {
+        return (data[i / 8] >> (i % 8)) & 1;
+    }
+
+    void set(size_t i, bool bit) {
+        uint8_t mask = uint8_t(1 << (i % 8));
+        data[i / 8] = bit ? (data[i / 8] | mask) : (data[i / 8] & ~mask);
+    }
+
+private:
+    size_t size_;
+};
+
+using PackedBitsView = BasicPackedBits<const uint8_t>;
+using PackedBits = BasicPackedBits<uint8_t>;
+
+}
+#endif // EMP_PACKED_BITS_H
@@ -30,9 +30,7 @@ public:
     }
 
     void permute_block(block *data, int nblocks) {
-        for(int i = 0; i < nblocks; ++i) {
-            AES_ecb_encrypt_blks(&data[i], 1, &aes);
-        }
+        AES_ecb_encrypt_blks(data, nblocks, &aes);
     }
 };
 }
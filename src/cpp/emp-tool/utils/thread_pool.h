@@ -0,0 +1,152 @@
+#ifndef EMP_THREAD_POOL_H
+#define EMP_THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Default pool size of the protocol engines (ot_threads, fpre_threads, ...),
+ * 1 keeps them on the calling thread. The wasm -pthread build sets it to its
+ * PTHREAD_POOL_SIZE, so the engines share exactly the preallocated workers.
+ */
+#ifndef EMP_THREADS
+#define EMP_THREADS 1
+#endif
+
+namespace emp {
+
+/*
+ * Fixed size thread pool.
+ * Only usable in native builds or wasm builds with pthreads.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads) {
+        for(int i = 0; i < threads; ++i)
+            workers.emplace_back([this] {
+                while(true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(queue_mutex);
+                        condition.wait(lock, [this] { return stop or !tasks.empty(); });
+                        if(stop and tasks.empty())
+                            return;
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                    }
+                    task();
+                }
+            });
+    }
+
+    ~ThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            stop = true;
+        }
+        condition.notify_all();
+        for(std::thread &worker: workers)
+            worker.join();
+    }
+
+    int size() const {
+        return workers.size();
+    }
+
+    template<class F, class... Args>
+    auto enqueue(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type> {
+        using return_type = typename std::invoke_result<F, Args...>::type;
+
+        auto task = std::make_shared<std::packaged_task<return_type()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+        );
+        std::future<return_type> res = task->get_future();
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if(stop)
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+            tasks.emplace([task]() { (*task)(); });
+        }
+        condition.notify_one();
+        return res;
+    }
+
+    /*
+     * Runs f(0) ... f(n-1) on the pool and the calling thread. Indices are
+     * claimed one at a time, so faster threads take more of them, and the
+     * caller never blocks on a task that has not started, which makes it
+     * safe to call from inside a pool task.
+     */
+    template<class F>
+    void parallel_for(int64_t n, F f) {
+        if(n <= 0)
+            return;
+        struct State {
+            std::atomic<int64_t> next{0}, done{0};
+            std::mutex error_mutex;
+            std::exception_ptr error;
+        };
+        auto state = std::make_shared<State>();
+        auto work = [state, n, f]() {
+            int64_t i;
+            while((i = state->next++) < n) {
+                try {
+                    f(i);
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(state->error_mutex);
+                    if(!state->error)
+                        state->error = std::current_exception();
+                }
+                ++state->done;
+            }
+        };
+        int64_t helpers = std::min<int64_t>(size(), n - 1);
+        for(int64_t i = 0; i < helpers; ++i)
+            enqueue(work);
+        work();
+        while(state->done < n)
+            std::this_thread::yield();
+        if(state->error)
+            std::rethrow_exception(state->error);
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable condition;
+    bool stop = false;
+};
+
+/*
+ * Pool of `threads` workers shared by every engine asking for that size,
+ * alive while any of them holds it. The engines only block on tasks through
+ * parallel_for or on tasks they enqueued themselves, so sharing cannot
+ * deadlock, and a wasm build with a fixed number of pthread workers serves
+ * all engines from one pool instead of one per engine.
+ */
+inline std::shared_ptr<ThreadPool> shared_thread_pool(int threads) {
+    static std::mutex pools_mutex;
+    static std::map<int, std::weak_ptr<ThreadPool>> pools;
+
+    std::lock_guard<std::mutex> lock(pools_mutex);
+    std::shared_ptr<ThreadPool> pool = pools[threads].lock();
+    if(!pool) {
+        pool = std::make_shared<ThreadPool>(threads);
+        pools[threads] = pool;
+    }
+    return pool;
+}
+
+}
+#endif // EMP_THREAD_POOL_H
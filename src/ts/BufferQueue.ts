@@ -5,7 +5,7 @@ export default class BufferQueue {
   private buffer: Uint8Array;
   private bufferStart: number;
   private bufferEnd: number;
-  private pendingPops: number[];
+  private pendingPops: { minLen: number, maxLen: number }[];
   private pendingPopsResolvers: {
     resolve: ((value: Uint8Array) => void),
     reject: (e: Error) => void,
@@ -66,18 +66,26 @@ export default class BufferQueue {
    * @returns A promise resolving with the popped data as a Uint8Array.
    */
   pop(len: number): Promise<Uint8Array> {
-    if (typeof len !== 'number' || len < 0) {
-      return Promise.reject(new Error('Length must be non-negative integer'));
+    return this.popAvailable(len, len);
+  }
+
+  /**
+   * Pops at least minLen and at most maxLen bytes, as many as are buffered
+   * once there are minLen of them.
+   * @param minLen - The number of bytes to wait for.
+   * @param maxLen - The most bytes to return.
+   * @returns A promise resolving with the popped data as a Uint8Array.
+   */
+  popAvailable(minLen: number, maxLen: number): Promise<Uint8Array> {
+    if (typeof minLen !== 'number' || minLen < 0 || !(maxLen >= minLen)) {
+      return Promise.reject(new Error('Lengths must be non-negative integers, minLen <= maxLen'));
     }
 
-    if (this.bufferEnd - this.bufferStart >= len) {
-      const result = this.buffer.slice(this.bufferStart, this.bufferStart + len);
-      this.bufferStart += len;
-      this._compactBuffer();
-      return Promise.resolve(result);
+    if (this.pendingPops.length === 0 && this.bufferEnd - this.bufferStart >= minLen) {
+      return Promise.resolve(this._take(maxLen));
     } else if (!this.closed) {
       return new Promise((resolve, reject) => {
-        this.pendingPops.push(len);
+        this.pendingPops.push({ minLen, maxLen });
         this.pendingPopsResolvers.push({ resolve, reject });
       });
     } else {
@@ -109,10 +117,9 @@ export default class BufferQueue {
    */
   private _resolvePendingPops(): void {
     while (this.pendingPops.length > 0) {
-      const len = this.pendingPops[0];
-      if (this.bufferEnd - this.bufferStart >= len) {
-        const data = this.buffer.slice(this.bufferStart, this.bufferStart + len);
-        this.bufferStart += len;
+      const { minLen, maxLen } = this.pendingPops[0];
+      if (this.bufferEnd - this.bufferStart >= minLen) {
+        const data = this._take(maxLen);
         this.pendingPops.shift();
         const { resolve } = this.pendingPopsResolvers.shift()!;
         resolve(data);
@@ -123,6 +130,17 @@ export default class BufferQueue {
     this._compactBuffer();
   }
 
+  /**
+   * Removes up to maxLen buffered bytes from the front.
+   */
+  private _take(maxLen: number): Uint8Array {
+    const len = Math.min(maxLen, this.bufferEnd - this.bufferStart);
+    const result = this.buffer.slice(this.bufferStart, this.bufferStart + len);
+    this.bufferStart += len;
+    this._compactBuffer();
+    return result;
+  }
+
   private _rejectPendingPops(error: Error): void {
     while (this.pendingPops.length > 0) {
       this.pendingPops.shift();
@@ -32,6 +32,16 @@ export default class BufferedIO
     return await this.bq[channel].pop(len);
   }
 
+  async recvAvailable(
+    fromParty: number,
+    channel: 'a' | 'b',
+    minLen: number,
+    maxLen: number,
+  ): Promise<Uint8Array> {
+    assert(fromParty === this.otherParty, 'fromParty !== this.otherParty');
+    return await this.bq[channel].popAvailable(minLen, maxLen);
+  }
+
   accept(channel: 'a' | 'b', data: Uint8Array) {
     this.bq[channel].push(data);
   }
@@ -0,0 +1,129 @@
+import type { IO } from "./types";
+
+// SharedRing header in jslib.cpp, as Int32 words
+const HEAD = 0;
+const TAIL = 1;
+const WANT = 2;
+const FAILED = 3;
+const CAPACITY = 4;
+const HEADER_BYTES = 32;
+
+type Ring = {
+  otherParty: number,
+  channel: 'a' | 'b',
+  outbound: boolean,
+  words: Int32Array,
+  data: Uint8Array,
+};
+
+/**
+ * Main thread end of the shared memory channels of the atomics builds.
+ *
+ * The worker's RingIOJS writes sends straight into an outbound ring in wasm
+ * memory and reads receives straight out of an inbound ring, so nothing is
+ * posted or cloned per send or recv. It rings the doorbell when it publishes
+ * sends, or when it needs bytes, and then this copies the outbound bytes to
+ * io.send, or fills the inbound ring with everything io has for the channel
+ * up to the free space.
+ */
+export default class RingBridge {
+  private rings = new Map<number, Ring>();
+
+  constructor(private io: IO) {}
+
+  /**
+   * Registers the two rings of a channel, from the worker's io_ring_open
+   * message.
+   */
+  open(
+    otherParty: number,
+    channel: 'a' | 'b',
+    outPtr: number,
+    inPtr: number,
+    memory: SharedArrayBuffer,
+  ): void {
+    for (const [ptr, outbound] of [[outPtr, true], [inPtr, false]] as const) {
+      const words = new Int32Array(memory, ptr, HEADER_BYTES / 4);
+      const data = new Uint8Array(memory, ptr + HEADER_BYTES, words[CAPACITY]);
+      this.rings.set(ptr, { otherParty, channel, outbound, words, data });
+    }
+  }
+
+  /**
+   * Handles the worker's io_ring message for the ring at ptr.
+   */
+  async doorbell(ptr: number): Promise<void> {
+    const ring = this.rings.get(ptr);
+
+    if (!ring) {
+      throw new Error(`Unknown ring ${ptr}`);
+    }
+
+    if (ring.outbound) {
+      this.drain(ring);
+    } else {
+      await this.fill(ring);
+    }
+  }
+
+  private drain(ring: Ring): void {
+    const { words } = ring;
+    const head = Atomics.load(words, HEAD) >>> 0;
+    const tail = Atomics.load(words, TAIL) >>> 0;
+    const len = (head - tail) >>> 0;
+
+    if (len === 0) {
+      return;
+    }
+
+    // io.send may keep the data, so it gets a copy
+    const data = new Uint8Array(len);
+    copyOut(ring.data, tail, data);
+    this.io.send(ring.otherParty, ring.channel, data);
+
+    Atomics.store(words, TAIL, head | 0);
+    Atomics.notify(words, TAIL);
+  }
+
+  private async fill(ring: Ring): Promise<void> {
+    const { words } = ring;
+    const want = Atomics.load(words, WANT);
+    const head = Atomics.load(words, HEAD) >>> 0;
+    const tail = Atomics.load(words, TAIL) >>> 0;
+    const space = ring.data.length - ((head - tail) >>> 0);
+
+    try {
+      const data = this.io.recvAvailable
+        ? await this.io.recvAvailable(ring.otherParty, ring.channel, want, space)
+        : await this.io.recv(ring.otherParty, ring.channel, want);
+
+      if (data.length < want || data.length > space) {
+        throw new Error('io returned the wrong number of bytes');
+      }
+
+      copyIn(ring.data, head, data);
+      Atomics.store(words, HEAD, (head + data.length) | 0);
+    } catch (error) {
+      Atomics.store(words, FAILED, 1);
+      throw error;
+    } finally {
+      // The worker waits for want to clear
+      Atomics.store(words, WANT, 0);
+      Atomics.notify(words, WANT);
+    }
+  }
+}
+
+function copyOut(ring: Uint8Array, pos: number, target: Uint8Array) {
+  const at = pos & (ring.length - 1);
+  const first = Math.min(target.length, ring.length - at);
+  target.set(ring.subarray(at, at + first));
+  target.set(ring.subarray(0, target.length - first), first);
+}
+
+function copyIn(ring: Uint8Array, pos: number, source: Uint8Array) {
+  const at = pos & (ring.length - 1);
+  const first = Math.min(source.length, ring.length - at);
+  ring.set(source.subarray(0, first), at);
+  ring.set(source.subarray(first), 0);
+}
@@ -0,0 +1,56 @@
+/**
+ * Idle instances of a build, wasm modules in NodeJS or workers in browsers,
+ * kept for later computations so they don't instantiate the wasm again.
+ * Only instances whose last session wound down cleanly are put back.
+ */
+export default class WarmPool<T> {
+  private idle = new Map<string, T[]>();
+
+  /**
+   * @param maxIdle - How many idle instances to keep per build.
+   * @param discard - Frees an instance that isn't kept.
+   */
+  constructor(
+    private maxIdle: number,
+    private discard: (instance: T) => void = () => {},
+  ) {}
+
+  /**
+   * Takes an idle instance of the build, if there is one.
+   */
+  take(build: string): T | undefined {
+    return this.idle.get(build)?.pop();
+  }
+
+  /**
+   * Returns an instance after a clean session, or discards it if the pool
+   * for its build is full.
+   */
+  put(build: string, instance: T): void {
+    let instances = this.idle.get(build);
+
+    if (!instances) {
+      instances = [];
+      this.idle.set(build, instances);
+    }
+
+    if (instances.length >= this.maxIdle) {
+      this.discard(instance);
+      return;
+    }
+
+    instances.push(instance);
+  }
+
+  /**
+   * Discards every idle instance. The wasm heap never shrinks, so this is
+   * how memory used by a large circuit is given back.
+   */
+  clear(): void {
+    for (const instances of this.idle.values()) {
+      instances.forEach(this.discard);
+    }
+
+    this.idle.clear();
+  }
+}
@@ -1,21 +1,97 @@
 import type { IO } from "./types";
 
+type Emp = {
+  circuit?: string;
+  circuitId?: string;
+  inputBits?: Uint8Array;
+  inputBitsPerParty?: number[];
+  io?: IO;
+  otK?: number | number[];
+  rings?: Rings;
+  handleOutput?: (value: Uint8Array) => void;
+  handlePrepared?: () => void;
+  handleError?: (error: Error) => void;
+};
+
 type Module = {
-  emp?: {
-    circuit?: string;
-    inputBits?: Uint8Array;
-    inputBitsPerParty?: number[];
-    io?: IO;
-    handleOutput?: (value: Uint8Array) => void;
-  };
-  _run_2pc(party: number, size: number): void;
-  _run_mpc(party: number, size: number): void;
+  emp?: Emp;
+  _run_2pc(party: number, size: number): void | Promise<void>;
+  _run_mpc(party: number, size: number): void | Promise<void>;
+  _run_sh2pc(party: number, size: number): void | Promise<void>;
+  _run_shmpc(party: number, size: number): void | Promise<void>;
+  _prepare_2pc(party: number, size: number): void | Promise<void>;
+  _prepare_mpc(party: number, size: number): void | Promise<void>;
+  _prepare_sh2pc(party: number, size: number): void | Promise<void>;
+  _prepare_shmpc(party: number, size: number): void | Promise<void>;
+  _run_online(): void | Promise<void>;
+  _reset_session(): number;
+  _load_circuit(): void;
   onRuntimeInitialized: () => void;
 };
 
+// Used by the atomics builds, whose channels are rings in shared wasm
+// memory that the main thread bridges to io (RingBridge.ts)
+type Rings = {
+  open(
+    otherParty: number,
+    channel: 'a' | 'b',
+    outPtr: number,
+    inPtr: number,
+    memory: SharedArrayBuffer,
+  ): void;
+  doorbell(ptr: number): void;
+};
+
 let running = false;
 
-declare const createModule: () => Promise<Module>
+// The worker keeps its module between computations, the main thread pools
+// workers whose last session wound down cleanly
+let modulePromise: Promise<Module> | undefined;
+
+// Set when the last session left the module ready for another one
+let reusable = false;
+
+// What prepareSecureMPC was given, for the online call that follows it
+let prepared: Omit<Emp, 'inputBits'> | undefined;
+
+// Circuit texts by loadCircuit id, least recently used first. The main
+// thread keeps the same list per worker (workerCircuits in secureMPC.ts) and
+// leaves the text out of messages for circuits that are in it.
+const circuits = new Map<string, string>();
+const maxCircuits = 4;
+
+/**
+ * The text of a start or prepare message's circuit, which is only sent the
+ * first time this worker runs it.
+ */
+function circuitFor(circuit: string | undefined, circuitId: string | undefined): string {
+  if (circuitId === undefined) {
+    if (circuit === undefined) {
+      throw new Error('No circuit');
+    }
+
+    return circuit;
+  }
+
+  const text = circuit ?? circuits.get(circuitId);
+
+  if (text === undefined) {
+    throw new Error(`Circuit ${circuitId} was not sent to this worker`);
+  }
+
+  circuits.delete(circuitId);
+  circuits.set(circuitId, text);
+
+  if (circuits.size > maxCircuits) {
+    circuits.delete(circuits.keys().next().value!);
+  }
+
+  return text;
+}
+
+declare const createModule: (moduleArg?: {
+  mainScriptUrlOrBlob?: string;
+}) => Promise<Module>
 
 /**
  * Runs a secure multi-party computation (MPC) using a specified circuit.
@@ -23,81 +99,200 @@ declare const createModule: () => Promise<Module>
  * @param party - The party index joining the computation (0, 1, .. N-1).
  * @param size - The number of parties in the computation.
  * @param circuit - The circuit to run.
- * @param inputBits - The input bits for the circuit, represented as one bit per byte.
+ * @param circuitId - The circuit's digest from loadCircuit, if it has one.
+ * @param inputBits - The input bits for the circuit, packed 8 bits to a byte.
  * @param inputBitsPerParty - The number of input bits for each party.
  * @param io - Input/output channels for communication between the two parties.
- * @returns A promise resolving with the output bits of the circuit.
+ * @param otK - SoftSpokenOT parameter for the OT extension in mpc mode, either
+ *   one value for every link or one value per party index. 1 (the default)
+ *   means IKNP, larger values (2, 4 or 8) send less but compute more. Both
+ *   ends of a link must use the same value.
+ * @param rings - Forwards the ring channels of the atomics builds to the main
+ *   thread, which they use instead of io.
+ * @returns A promise resolving with the output bits of the circuit, packed.
  */
 async function secureMPC({
-  party, size, circuit, inputBits, inputBitsPerParty, io, mode = 'auto',
+  party, size, circuit, circuitId, inputBits, inputBitsPerParty, io,
+  mode = 'auto', otK, rings,
 }: {
   party: number,
   size: number,
   circuit: string,
+  circuitId?: string,
   inputBits: Uint8Array,
   inputBitsPerParty: number[],
   io: IO,
-  mode?: '2pc' | 'mpc' | 'auto',
+  mode?: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  otK?: number | number[],
+  rings?: Rings,
 }): Promise<Uint8Array> {
-  const module = await createModule();
+  const module = await beginSession();
+
+  try {
+    const protocol = calculateProtocol(mode, size, circuit);
+
+    const output = await callModule(module, {
+      circuit, circuitId, inputBits, inputBitsPerParty, io, otK, rings,
+    }, 'handleOutput', () => module[`_run_${protocol}` as const](party, size));
+
+    reusable = module._reset_session() === 1;
+
+    return output;
+  } finally {
+    running = false;
+  }
+}
+
+/**
+ * Runs everything that doesn't depend on the inputs, with the same
+ * parameters as secureMPC apart from inputBits, which onlineSecureMPC takes.
+ */
+async function prepareSecureMPC({
+  party, size, circuit, circuitId, inputBitsPerParty, io, mode = 'auto', otK,
+  rings,
+}: {
+  party: number,
+  size: number,
+  circuit: string,
+  circuitId?: string,
+  inputBitsPerParty: number[],
+  io: IO,
+  mode?: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  otK?: number | number[],
+  rings?: Rings,
+}): Promise<void> {
+  const module = await beginSession();
+
+  try {
+    const protocol = calculateProtocol(mode, size, circuit);
+    const inputs = { circuit, circuitId, inputBitsPerParty, io, otK, rings };
+
+    await callModule(module, inputs, 'handlePrepared', () => {
+      return module[`_prepare_${protocol}` as const](party, size);
+    });
+
+    // Still running until onlineSecureMPC
+    prepared = inputs;
+  } catch (error) {
+    running = false;
+    throw error;
+  }
+}
+
+async function onlineSecureMPC(inputBits: Uint8Array): Promise<Uint8Array> {
+  if (!prepared) {
+    throw new Error('Nothing prepared');
+  }
+
+  const module = await modulePromise!;
+  const inputs = prepared;
+  prepared = undefined;
+
+  try {
+    const output = await callModule(module, {
+      ...inputs, inputBits,
+    }, 'handleOutput', () => module._run_online());
+
+    reusable = module._reset_session() === 1;
+
+    return output;
+  } finally {
+    running = false;
+  }
+}
+
+/**
+ * Parses a circuit into the module's cache ahead of the computations that
+ * run it (loadCircuit in secureMPC.ts).
+ */
+async function loadCircuit(circuit: string, circuitId: string): Promise<void> {
+  const module = await getModule();
+
+  if (running) {
+    throw new Error('Can only load a circuit between computations');
+  }
+
+  let failure: Error | undefined;
+
+  module.emp = {
+    circuit,
+    circuitId,
+    handleError: error => {
+      failure = error;
+    },
+  };
+
+  module._load_circuit();
+
+  if (failure) {
+    throw failure;
+  }
+}
+
+function getModule(): Promise<Module> {
+  // The multithreaded build starts its pthread workers from this same
+  // script, which lives at a blob URL emscripten can't work out itself.
+  modulePromise ??= createModule({ mainScriptUrlOrBlob: self.location.href });
+  return modulePromise;
+}
+
+async function beginSession(): Promise<Module> {
+  const module = await getModule();
 
   if (running) {
     throw new Error('Can only run one secureMPC at a time');
   }
 
   running = true;
+  reusable = false;
 
-  const emp: {
-    circuit?: string;
-    inputBits?: Uint8Array;
-    inputBitsPerParty?: number[];
-    io?: IO;
-    handleOutput?: (value: Uint8Array) => void
-    handleError?: (error: Error) => void;
-  } = {};
+  return module;
+}
 
+/**
+ * Sets Module.emp for one call into the module and resolves with what the
+ * C++ hands to Module.emp[handler].
+ */
+function callModule<K extends 'handleOutput' | 'handlePrepared'>(
+  module: Module,
+  inputs: Emp,
+  handler: K,
+  invoke: () => void | Promise<void>,
+): Promise<Parameters<NonNullable<Emp[K]>>[0]> {
+  const emp: Emp = { ...inputs };
   module.emp = emp;
 
-  emp.circuit = circuit;
-  emp.inputBits = inputBits;
-  emp.inputBitsPerParty = inputBitsPerParty;
-  emp.io = io;
-
-  const method = calculateMethod(mode, size, circuit);
-
-  const result = new Promise<Uint8Array>((resolve, reject) => {
+  return new Promise((resolve, reject) => {
     try {
-      emp.handleOutput = resolve;
+      emp[handler] = resolve as never;
       emp.handleError = reject;
 
-      module[method](party, size);
+      // The JSPI build returns a promise here, which rejects if a suspended
+      // recv throws.
+      Promise.resolve(invoke()).catch(reject);
     } catch (error) {
       reject(error);
     }
   });
-
-  try {
-    return await result;
-  } finally {
-    running = false;
-  }
 }
 
-function calculateMethod(
-  mode: '2pc' | 'mpc' | 'auto',
+function calculateProtocol(
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
   size: number,
 
   // Currently unused, but some 2-party circuits might perform better with
-  // _runMPC
+  // mpc
   _circuit: string,
-) {
+): '2pc' | 'mpc' | 'sh2pc' | 'shmpc' {
   switch (mode) {
     case '2pc':
-      return '_run_2pc';
+      return '2pc';
     case 'mpc':
-      return '_run_mpc';
+      return 'mpc';
     case 'auto':
-      return size === 2 ? '_run_2pc' : '_run_mpc';
+      return size === 2 ? '2pc' : 'mpc';
+    case 'semi-honest':
+      return size === 2 ? 'sh2pc' : 'shmpc';
 
     default:
       const _never: never = mode;
@@ -114,52 +309,120 @@ const pendingRequests: {
   };
 } = {};
 
-onmessage = async (event) => {
-  const message = event.data;
-
-  if (message.type === 'start') {
-    const { party, size, circuit, inputBits, inputBitsPerParty, mode } = message;
-
-    // Create a proxy IO object to communicate with the main thread
-    const io: IO = {
-      send: (toParty, channel, data) => {
-        postMessage({ type: 'io_send', toParty, channel, data });
-      },
-      recv: (fromParty, channel, len) => {
-        return new Promise((resolve, reject) => {
-          const id = requestId++;
-          pendingRequests[id] = { resolve, reject };
-          postMessage({ type: 'io_recv', fromParty, channel, len, id });
+// Proxy IO object to communicate with the main thread
+const workerIO: IO = {
+  send: (toParty, channel, data) => {
+    // data is a fresh copy out of the wasm heap, so its buffer can be
+    // moved to the main thread instead of cloned.
+    postMessage(
+      { type: 'io_send', toParty, channel, data },
+      { transfer: [data.buffer as ArrayBuffer] },
+    );
+  },
+  recv: (fromParty, channel, len) => {
+    return new Promise((resolve, reject) => {
+      const id = requestId++;
+      pendingRequests[id] = { resolve, reject };
+      postMessage({ type: 'io_recv', fromParty, channel, len, id });
+    });
+  },
+  recvAvailable: (fromParty, channel, len, maxLen) => {
+    return new Promise((resolve, reject) => {
+      const id = requestId++;
+      pendingRequests[id] = { resolve, reject };
+      postMessage({ type: 'io_recv', fromParty, channel, len, maxLen, id });
+    });
+  },
+};
+
+const workerRings: Rings = {
+  open: (otherParty, channel, outPtr, inPtr, memory) => {
+    postMessage({ type: 'io_ring_open', otherParty, channel, outPtr, inPtr, memory });
+  },
+  doorbell: (ptr) => {
+    postMessage({ type: 'io_ring', ptr });
+  },
+};
+
+// Pthread workers of the multithreaded build run this script too, and the
+// emscripten code above handles their messages.
+const isPthread = (self.name ?? '').startsWith('em-pthread');
+
+if (!isPthread) {
+  onmessage = async (event) => {
+    const message = event.data;
+
+    if (message.type === 'start') {
+      const {
+        party, size, circuit, circuitId, inputBits, inputBitsPerParty, mode, otK,
+      } = message;
+
+      try {
+        const result = await secureMPC({
+          party,
+          size,
+          circuit: circuitFor(circuit, circuitId),
+          circuitId,
+          inputBits,
+          inputBitsPerParty,
+          io: workerIO,
+          mode,
+          otK,
+          rings: workerRings,
         });
-      },
-    };
 
-    try {
-      const result = await secureMPC({
-        party,
-        size,
-        circuit,
-        inputBits,
-        inputBitsPerParty,
-        io,
-        mode,
-      });
-
-      postMessage({ type: 'result', result });
-    } catch (error) {
-      postMessage({ type: 'error', error: (error as Error).stack });
-    }
-  } else if (message.type === 'io_recv_response') {
-    const { id, data } = message;
-    if (pendingRequests[id]) {
-      pendingRequests[id].resolve(data);
-      delete pendingRequests[id];
-    }
-  } else if (message.type === 'io_recv_error') {
-    const { id, error } = message;
-    if (pendingRequests[id]) {
-      pendingRequests[id].reject(new Error(error));
-      delete pendingRequests[id];
+        postMessage({ type: 'result', result, reusable });
+      } catch (error) {
+        postMessage({ type: 'error', error: (error as Error).stack });
+      }
+    } else if (message.type === 'prepare') {
+      const { party, size, circuit, circuitId, inputBitsPerParty, mode, otK } = message;
+
+      try {
+        await prepareSecureMPC({
+          party,
+          size,
+          circuit: circuitFor(circuit, circuitId),
+          circuitId,
+          inputBitsPerParty,
+          io: workerIO,
+          mode,
+          otK,
+          rings: workerRings,
+        });
+
+        postMessage({ type: 'prepared' });
+      } catch (error) {
+        postMessage({ type: 'error', error: (error as Error).stack });
+      }
+    } else if (message.type === 'load') {
+      const { circuit, circuitId } = message;
+
+      try {
+        await loadCircuit(circuitFor(circuit, circuitId), circuitId);
+        postMessage({ type: 'loaded' });
+      } catch (error) {
+        postMessage({ type: 'error', error: (error as Error).stack });
+      }
+    } else if (message.type === 'online') {
+      try {
+        const result = await onlineSecureMPC(message.inputBits);
+        postMessage({ type: 'result', result, reusable });
+      } catch (error) {
+        postMessage({ type: 'error', error: (error as Error).stack });
+      }
+    } else if (message.type === 'io_recv_response') {
+      const { id, data } = message;
+      if (pendingRequests[id]) {
+        pendingRequests[id].resolve(data);
+        delete pendingRequests[id];
+      }
+    } else if (message.type === 'io_recv_error') {
+      const { id, error } = message;
+      if (pendingRequests[id]) {
+        pendingRequests[id].reject(new Error(error));
+        delete pendingRequests[id];
+      }
     }
-  }
-};
+  };
+}
@@ -13,7 +13,7 @@ windowAny.secureMPC = secureMPC;
 windowAny.internalDemo = async function(
   aliceInput: number,
   bobInput: number,
-  mode: '2pc' | 'mpc' | 'auto' = 'auto',
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest' = 'auto',
 ): Promise<{ alice: number, bob: number }> {
   const aliceBq = { a: new BufferQueue(), b: new BufferQueue() };
   const bobBq = { a: new BufferQueue(), b: new BufferQueue() };
@@ -55,7 +55,7 @@ windowAny.internalDemo3 = async function(
   aliceInput: number,
   bobInput: number,
   charlieInput: number,
-  mode: '2pc' | 'mpc' | 'auto' = 'auto',
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest' = 'auto',
 ): Promise<{ alice: number, bob: number, charlie: number }> {
   const bqs = new BufferQueueStore();
   const inputs = [aliceInput, bobInput, charlieInput];
@@ -80,10 +80,68 @@ windowAny.internalDemo3 = async function(
   };
 }
 
+/**
+ * Measures how fast two in-page parties move data between their workers and
+ * this page, on a circuit of `andGates` AND gates. The shared memory rings
+ * need the page to be cross-origin isolated (npm run demo serves it that
+ * way), otherwise that build is skipped.
+ */
+windowAny.benchThroughput = async function(
+  andGates = 1_000_000,
+): Promise<Record<string, string>> {
+  const circuit = andChainCircuit(andGates);
+
+  const builds: Record<string, { threads: boolean, jspi: boolean, atomics?: boolean }> = {
+    rings: { threads: false, jspi: false, atomics: true },
+    jspi: { threads: false, jspi: true },
+    threads: { threads: true, jspi: false },
+  };
+
+  const results: Record<string, string> = {};
+
+  for (const [name, options] of Object.entries(builds)) {
+    const bqs = new BufferQueueStore();
+    let bytes = 0;
+    const start = performance.now();
+
+    try {
+      await Promise.all([0, 1].map(party => secureMPC({
+        party,
+        size: 2,
+        circuit,
+        inputBits: numberTo32Bits(party + 1),
+        inputBitsPerParty: [32, 32],
+        io: {
+          send: (toParty, channel, data) => {
+            bytes += data.length;
+            bqs.get(party, toParty, channel).push(data);
+          },
+          recv: (fromParty, channel, len) => bqs.get(fromParty, party, channel).pop(len),
+          recvAvailable: (fromParty, channel, minLen, maxLen) => {
+            return bqs.get(fromParty, party, channel).popAvailable(minLen, maxLen);
+          },
+        },
+        mode: '2pc',
+        ...options,
+      })));
+    } catch (error) {
+      results[name] = `skipped, ${(error as Error).message}`;
+      continue;
+    }
+
+    const seconds = (performance.now() - start) / 1000;
+
+    results[name] = `${(bytes / 1e6 / seconds).toFixed(1)} MB/s ` +
+      `(${(bytes / 1e6).toFixed(1)} MB in ${seconds.toFixed(2)} s)`;
+  }
+
+  return results;
+}
+
 windowAny.consoleDemo = async function(
   party: number,
   input: number,
-  mode: '2pc' | 'mpc' | 'auto' = 'auto',
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest' = 'auto',
 ): Promise<void> {
   const otherParty = party === 0 ? 1 : 0;
 
@@ -103,7 +161,7 @@ windowAny.consoleDemo = async function(
 windowAny.wsDemo = async function(
   party: number,
   input: number,
-  mode: '2pc' | 'mpc' | 'auto' = 'auto',
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest' = 'auto',
 ): Promise<number> {
   const otherParty = party === 0 ? 1 : 0;
   const io = await makeWebSocketIO('ws://localhost:8175/demo', otherParty);
@@ -127,7 +185,7 @@ windowAny.rtcDemo = async function(
   pairingCode: string,
   party: number,
   input: number,
-  mode: '2pc' | 'mpc' | 'auto' = 'auto',
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest' = 'auto',
 ): Promise<number> {
   const io = await makePeerIO(pairingCode, party);
 
@@ -281,6 +339,22 @@ async function makePeerIO(pairingCode: string, party: number) {
   return io;
 }
 
+/**
+ * Builds a Bristol circuit of two 32-bit inputs and `andGates` chained AND
+ * gates, each ANDing two neighbouring wires. The last 32 wires are the
+ * output.
+ */
+function andChainCircuit(andGates: number): string {
+  const gateCount = Math.max(andGates, 32);
+  const lines = [`${gateCount} ${64 + gateCount}`, '32 32 32', ''];
+
+  for (let i = 0; i < gateCount; i++) {
+    lines.push(`2 1 ${i} ${i + 1} ${64 + i} AND`);
+  }
+
+  return lines.join('\n');
+}
+
 class BufferQueueStore {
   bqs = new Map<string, BufferQueue>();
 
@@ -1,4 +1,8 @@
-export { default as secureMPC } from "./secureMPC.js";
+export {
+  default as secureMPC, loadCircuit, prepareSecureMPC, releaseWarmModules,
+} from "./secureMPC.js";
 export { default as BufferedIO } from "./BufferedIO.js";
 export { default as BufferQueue } from "./BufferQueue.js";
-export { type IO } from "./types";
+export { packBits, unpackBits } from "./packedBits.js";
+export { type LoadedCircuit } from "./loadCircuit.js";
+export { type IO, type PreparedMPC } from "./types";
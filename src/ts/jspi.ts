@@ -0,0 +1,33 @@
+/**
+ * Decides whether to load the JSPI (JavaScript Promise Integration) build.
+ *
+ * @param jspi - true to use the JSPI build, anything else keeps the
+ *   ASYNCIFY build. It isn't picked by default until it has passed npm test
+ *   and npm run bench:builds.
+ * @returns true if the JSPI build should be used.
+ */
+export default function shouldUseJspi(jspi: boolean | undefined): boolean {
+  if (jspi !== true) {
+    return false;
+  }
+
+  if (!supportsJspi()) {
+    throw new Error(
+      'jspi requested but WebAssembly JSPI is not supported here ' +
+      '(NodeJS before v25 needs --experimental-wasm-jspi)',
+    );
+  }
+
+  return true;
+}
+
+/**
+ * Detects the standardized JSPI API that emscripten's -sJSPI output uses.
+ */
+export function supportsJspi(): boolean {
+  const wasm = (globalThis as {
+    WebAssembly?: { Suspending?: unknown, promising?: unknown },
+  }).WebAssembly;
+
+  return typeof wasm?.Suspending === 'function' && typeof wasm?.promising === 'function';
+}
@@ -0,0 +1,40 @@
+/**
+ * A circuit with the digest wasm modules keep its parsed form under, from
+ * loadCircuit. It can be passed as the circuit of secureMPC and
+ * prepareSecureMPC in place of the text.
+ */
+export type LoadedCircuit = {
+  id: string,
+  circuit: string,
+};
+
+/**
+ * The SHA-256 digest of a circuit in hex, its id in a LoadedCircuit.
+ */
+export async function circuitDigest(circuit: string): Promise<string> {
+  const subtle = globalThis.crypto?.subtle;
+
+  if (!subtle) {
+    throw new Error('loadCircuit needs WebCrypto (a secure context in browsers)');
+  }
+
+  const digest = await subtle.digest('SHA-256', new TextEncoder().encode(circuit));
+
+  return Array.from(new Uint8Array(digest))
+    .map(b => b.toString(16).padStart(2, '0'))
+    .join('');
+}
+
+/**
+ * Splits the circuit parameter of secureMPC into its text and cache id.
+ */
+export function circuitText(circuit: string | LoadedCircuit): {
+  circuit: string,
+  circuitId?: string,
+} {
+  if (typeof circuit === 'string') {
+    return { circuit };
+  }
+
+  return { circuit: circuit.circuit, circuitId: circuit.id };
+}
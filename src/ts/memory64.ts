@@ -0,0 +1,107 @@
+/**
+ * Estimated heap above which the wasm64 build is used. wasm32 tops out at
+ * 4 GB, and the heap needs headroom for fragmentation and io buffers.
+ */
+const MEMORY64_THRESHOLD = 3 * 2 ** 30;
+
+/**
+ * Decides whether to load the memory64 (wasm64) build.
+ *
+ * @param memory64 - true or false to force a build, undefined to decide from
+ *   the estimated heap size.
+ * @returns true if the wasm64 build should be used.
+ */
+export default function shouldUseMemory64(
+  memory64: boolean | undefined,
+  circuit: string,
+  size: number,
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+): boolean {
+  if (memory64 === false) {
+    return false;
+  }
+
+  const supported = supportsMemory64();
+
+  if (memory64 === true) {
+    if (!supported) {
+      throw new Error(
+        'memory64 requested but WebAssembly memory64 is not supported here ' +
+        '(NodeJS before v24 needs --experimental-wasm-memory64)',
+      );
+    }
+
+    return true;
+  }
+
+  // Without memory64 support, try the wasm32 build anyway. Jobs near the
+  // threshold may still fit.
+  return supported && estimateHeapBytes(circuit, size, mode) > MEMORY64_THRESHOLD;
+}
+
+/**
+ * Rough upper bound on the wasm heap a job needs, in bytes. The gate count
+ * stands in for the AND count so the circuit doesn't need to be scanned.
+ */
+export function estimateHeapBytes(
+  circuit: string,
+  size: number,
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+): number {
+  const [numGate, numWire] = circuit
+    .slice(0, circuit.indexOf('\n'))
+    .trim()
+    .split(/\s+/)
+    .map(Number);
+
+  if (!Number.isFinite(numGate) || !Number.isFinite(numWire)) {
+    return 0;
+  }
+
+  const blockSize = 16;
+
+  // The circuit string, its copy in the heap and the parsed gates
+  let bytes = 2 * circuit.length + 16 * numGate;
+
+  if (mode === 'semi-honest' && size === 2) {
+    // SH2PC: one label per wire, garbled tables stream through the channel
+    bytes += blockSize * numWire;
+  } else if (mode === '2pc' || (mode === 'auto' && size === 2)) {
+    // Fpre: MAC and KEY for up to 5 * 3 bits per AND while bucketing.
+    // C2PC: key, mac, labels per wire and sigma, GT, GTK, GTM per AND.
+    bytes += blockSize * (numGate * (2 * 5 * 3 + 2 + 8 + 4 + 4) + numWire * 3);
+  } else {
+    const n = size + 1;
+
+    // Semi-honest mode doesn't bucket, so FpreMP only has tMAC and tKEY
+    // for 3 bits per AND.
+    const fpre = mode === 'semi-honest' ? 2 * n * 3 : 4 * n * 5 * 3;
+
+    // FpreMP: tMAC, tKEY, tKEYphi, tMACphi for up to 5 * 3 bits per AND.
+    // CMPC: GT (n * 4 * n), GTK and GTM (4 * n each), ANDS and sigma shares
+    // per AND at party 1, plus key, mac, eval_labels per wire.
+    bytes += blockSize * (
+      numGate * (fpre + 4 * n * n + 8 * n + 8 * n) +
+      numWire * 3 * n
+    );
+  }
+
+  return bytes;
+}
+
+let memory64Support: boolean | undefined;
+
+/**
+ * Detects wasm memory64 by validating a module that only declares a 64-bit
+ * memory.
+ */
+export function supportsMemory64(): boolean {
+  if (memory64Support === undefined) {
+    memory64Support = typeof WebAssembly !== 'undefined' && WebAssembly.validate(
+      // \0asm, version 1, memory section with one i64 memory of 0 pages
+      new Uint8Array([0, 97, 115, 109, 1, 0, 0, 0, 5, 3, 1, 4, 0]),
+    );
+  }
+
+  return memory64Support;
+}
@@ -1,4 +1,21 @@
-import type { IO } from "./types";
+import type { IO, PreparedMPC } from "./types";
+import shouldUseMemory64 from "./memory64.js";
+import shouldUseThreads from "./threads.js";
+import shouldUseJspi from "./jspi.js";
+import WarmPool from "./WarmPool.js";
+
+// Parties of one computation often share a process, so a few modules of each
+// build are kept.
+const warmModules = new WarmPool<any>(4, releaseModule);
+
+/**
+ * Drops the idle modules kept for later calls, freeing their wasm memory and
+ * joining the threads of the multithreaded build, which would otherwise keep
+ * NodeJS running.
+ */
+export function releaseWarmModules(): void {
+  warmModules.clear();
+}
 
 /**
  * Runs a secure multi-party computation (MPC) using a specified circuit.
@@ -6,75 +23,271 @@ import type { IO } from "./types";
  * @param party - The party index joining the computation (0, 1, .. N-1).
  * @param size - The number of parties in the computation.
  * @param circuit - The circuit to run.
- * @param inputBits - The input to the circuit, represented as one bit per byte.
+ * @param circuitId - The circuit's digest from loadCircuit, under which the
+ *   module caches the parsed circuit.
+ * @param inputBits - The input to the circuit, packed 8 bits to a byte (see
+ *   packBits). secureMPC packs it unless called with packed.
  * @param inputBitsPerParty - The number of input bits for each party.
  * @param io - Input/output channels for communication between the two parties.
- * @returns A promise resolving with the output bits of the circuit.
+ * @param otK - SoftSpokenOT parameter for the OT extension in mpc mode, either
+ *   one value for every link or one value per party index. 1 (the default)
+ *   means IKNP, larger values (2, 4 or 8) send less but compute more. Both
+ *   ends of a link must use the same value.
+ * @param memory64 - Use the wasm64 build, which can grow past 4 GB. Defaults
+ *   to using it when the circuit is estimated to need more than about 3 GB
+ *   and memory64 is supported. NodeJS before v24 needs
+ *   --experimental-wasm-memory64.
+ * @param threads - Use the multithreaded build, which spreads OT extension,
+ *   garbling and evaluation over a pool of wasm threads. Defaults to using
+ *   it on cross-origin isolated pages in browsers with more than one core,
+ *   NodeJS only uses it when it's true. Not available with memory64.
+ * @param jspi - Use the JSPI build, which suspends only at the recv import
+ *   instead of instrumenting all of the C++ like the default ASYNCIFY build.
+ *   Only used when it's true, and not with memory64 or threads. NodeJS before v25 needs --experimental-wasm-jspi.
+ * @returns A promise resolving with the output bits of the circuit, packed
+ *   like the input.
  */
 export default async function nodeSecureMPC({
-  party, size, circuit, inputBits, inputBitsPerParty, io, mode = 'auto',
+  party, size, circuit, circuitId, inputBits, inputBitsPerParty, io,
+  mode = 'auto', otK, memory64, threads, jspi,
 }: {
   party: number,
   size: number,
   circuit: string,
+  circuitId?: string,
   inputBits: Uint8Array,
   inputBitsPerParty: number[],
   io: IO,
-  mode?: '2pc' | 'mpc' | 'auto',
+  mode?: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  otK?: number | number[],
+  memory64?: boolean,
+  threads?: boolean,
+  jspi?: boolean,
 }): Promise<Uint8Array> {
+  const { build, module } = await loadModule({ circuit, size, mode, memory64, threads, jspi });
+
+  const result = await callModule(module, {
+    circuit, circuitId, inputBits, inputBitsPerParty, io, otK,
+  }, 'handleOutput', () => module[`_run_${calculateProtocol(mode, size, circuit)}`](party, size));
+
+  keepIfReusable(build, module);
+
+  return result;
+}
+
+/**
+ * Runs everything in a computation that doesn't depend on the inputs, see
+ * prepareSecureMPC in secureMPC.ts.
+ */
+export async function nodePrepareSecureMPC({
+  party, size, circuit, circuitId, inputBitsPerParty, io, mode = 'auto', otK,
+  memory64, threads, jspi,
+}: {
+  party: number,
+  size: number,
+  circuit: string,
+  circuitId?: string,
+  inputBitsPerParty: number[],
+  io: IO,
+  mode?: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  otK?: number | number[],
+  memory64?: boolean,
+  threads?: boolean,
+  jspi?: boolean,
+}): Promise<PreparedMPC> {
+  const { build, module } = await loadModule({ circuit, size, mode, memory64, threads, jspi });
+
+  await callModule(module, {
+    circuit, circuitId, inputBitsPerParty, io, otK,
+  }, 'handlePrepared', () => module[`_prepare_${calculateProtocol(mode, size, circuit)}`](party, size));
+
+  let used = false;
+
+  return {
+    online: async (inputBits: Uint8Array) => {
+      if (used) {
+        throw new Error('online can only be called once');
+      }
+
+      used = true;
+
+      const result = await callModule(module, {
+        circuit, inputBits, inputBitsPerParty, io, otK,
+      }, 'handleOutput', () => module._run_online());
+
+      keepIfReusable(build, module);
+
+      return result;
+    },
+    abort: () => {
+      // The module still holds the prepared session, so it's just dropped
+      used = true;
+    },
+  };
+}
+
+/**
+ * Parses a loaded circuit into `instances` warm modules of the build that
+ * nodeSecureMPC would pick for the other parameters, see loadCircuit in
+ * secureMPC.ts.
+ */
+export async function nodeLoadCircuit({
+  circuit, circuitId, size, mode, memory64, threads, jspi, instances,
+}: {
+  circuit: string,
+  circuitId: string,
+  size: number,
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  memory64?: boolean,
+  threads?: boolean,
+  jspi?: boolean,
+  instances: number,
+}): Promise<void> {
+  // All taken before any goes back, so each is a different module
+  const modules = [];
+
+  for (let i = 0; i < instances; i++) {
+    modules.push(await loadModule({ circuit, size, mode, memory64, threads, jspi }));
+  }
+
+  let failure: Error | undefined;
+
+  for (const { build, module } of modules) {
+    if (!failure) {
+      module.emp = {
+        circuit,
+        circuitId,
+        handleError: (error: Error) => {
+          failure = error;
+        },
+      };
+
+      module._load_circuit();
+    }
+
+    keepIfReusable(build, module);
+  }
+
+  if (failure) {
+    throw failure;
+  }
+}
+
+async function loadModule({ circuit, size, mode, memory64, threads, jspi }: {
+  circuit: string,
+  size: number,
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  memory64?: boolean,
+  threads?: boolean,
+  jspi?: boolean,
+}): Promise<{ build: string, module: any }> {
   if (typeof process === 'undefined' || typeof process.versions === 'undefined' || !process.versions.node) {
     throw new Error('Not running in Node.js');
   }
 
-  let module = await ((await import('../../build/jslib.js')).default());
+  const useMemory64 = shouldUseMemory64(memory64, circuit, size, mode);
 
+  let build: string;
+  let loadCreateModule;
+
+  if (useMemory64) {
+    build = 'jslib64';
+    loadCreateModule = async () => (await import('../../build/jslib64.js')).default;
+  } else if (shouldUseThreads(threads, useMemory64)) {
+    build = 'jslib-mt';
+    loadCreateModule = async () => (await import('../../build/jslib-mt.js')).default;
+  } else if (shouldUseJspi(jspi)) {
+    build = 'jslib-jspi';
+    loadCreateModule = async () => (await import('../../build/jslib-jspi.js')).default;
+  } else {
+    build = 'jslib';
+    loadCreateModule = async () => (await import('../../build/jslib.js')).default;
+  }
+
+  // Modules run any number of sessions one after another, instantiating the
+  // wasm usually costs more than a small circuit
+  const module = warmModules.take(build) ?? await (await loadCreateModule())();
+
+  return { build, module };
+}
+
+/**
+ * Sets Module.emp for one call into the module and resolves with what the
+ * C++ hands to Module.emp[handler].
+ */
+function callModule<K extends 'handleOutput' | 'handlePrepared'>(
+  module: any,
+  inputs: {
+    circuit: string,
+    circuitId?: string,
+    inputBits?: Uint8Array,
+    inputBitsPerParty: number[],
+    io: IO,
+    otK?: number | number[],
+  },
+  handler: K,
+  invoke: () => void | Promise<void>,
+): Promise<K extends 'handleOutput' ? Uint8Array : void> {
   const emp: {
     circuit?: string;
+    circuitId?: string;
     inputBits?: Uint8Array;
     inputBitsPerParty?: number[];
     io?: IO;
+    otK?: number | number[];
     handleOutput?: (value: Uint8Array) => void;
+    handlePrepared?: () => void;
     handleError?: (error: Error) => void;
-  } = {};
+  } = { ...inputs };
 
   module.emp = emp;
 
-  emp.circuit = circuit;
-  emp.inputBits = inputBits;
-  emp.inputBitsPerParty = inputBitsPerParty;
-  emp.io = io;
-
-  const method = calculateMethod(mode, size, circuit);
-
-  const result = await new Promise<Uint8Array>((resolve, reject) => {
+  return new Promise((resolve, reject) => {
     try {
-      emp.handleOutput = resolve;
+      emp[handler] = resolve as never;
       emp.handleError = reject;
 
-      module[method](party, size);
+      // The JSPI build returns a promise here, which rejects if a suspended
+      // recv throws.
+      Promise.resolve(invoke()).catch(reject);
     } catch (error) {
       reject(error);
     }
   });
+}
 
-  return result;
+function keepIfReusable(build: string, module: any) {
+  // A failed session may still be suspended in recv, so only modules that
+  // finished cleanly are kept
+  if (module._reset_session()) {
+    warmModules.put(build, module);
+  } else {
+    releaseModule(module);
+  }
+}
+
+// Dropping the module doesn't stop its threads, release them first
+function releaseModule(module: any) {
+  module._release_threads();
 }
 
-function calculateMethod(
-  mode: '2pc' | 'mpc' | 'auto',
+function calculateProtocol(
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
   size: number,
 
   // Currently unused, but some 2-party circuits might perform better with
-  // _runMPC
+  // mpc
   _circuit: string,
-) {
+): '2pc' | 'mpc' | 'sh2pc' | 'shmpc' {
   switch (mode) {
     case '2pc':
-      return '_run_2pc';
+      return '2pc';
     case 'mpc':
-      return '_run_mpc';
+      return 'mpc';
     case 'auto':
-      return size === 2 ? '_run_2pc' : '_run_mpc';
+      return size === 2 ? '2pc' : 'mpc';
+    case 'semi-honest':
+      return size === 2 ? 'sh2pc' : 'shmpc';
 
     default:
       const _never: never = mode;
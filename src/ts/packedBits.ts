@@ -0,0 +1,66 @@
+/**
+ * Packs bits given one per byte into 8 per byte, little-endian: bit i ends up
+ * at (packed[i >> 3] >> (i & 7)) & 1. This is the layout the wasm takes its
+ * inputs and returns its outputs in.
+ */
+export function packBits(bits: Uint8Array): Uint8Array {
+  const packed = new Uint8Array(Math.ceil(bits.length / 8));
+
+  for (let i = 0; i < bits.length; i++) {
+    packed[i >> 3] |= (bits[i] & 1) << (i & 7);
+  }
+
+  return packed;
+}
+
+/**
+ * Unpacks the first count bits of packBits' layout into one bit per byte.
+ */
+export function unpackBits(packed: Uint8Array, count: number): Uint8Array {
+  if (packed.length !== Math.ceil(count / 8)) {
+    throw new Error(`Expected ${count} packed bits, got ${packed.length} bytes`);
+  }
+
+  const bits = new Uint8Array(count);
+
+  for (let i = 0; i < count; i++) {
+    bits[i] = (packed[i >> 3] >> (i & 7)) & 1;
+  }
+
+  return bits;
+}
+
+/**
+ * Packs one party's input for the wasm, unless the caller already packed it,
+ * checking it has that party's number of bits.
+ */
+export function packInput(
+  inputBits: Uint8Array,
+  bitCount: number,
+  packed: boolean,
+): Uint8Array {
+  if (packed) {
+    return inputBits;
+  }
+
+  if (inputBits.length !== bitCount) {
+    throw new Error('Mismatch between inputBits and inputBitsPerParty');
+  }
+
+  return packBits(inputBits);
+}
+
+/**
+ * The number of output bits of a Bristol format circuit, the third number on
+ * its second line.
+ */
+export function outputBitCount(circuit: string): number {
+  const header = circuit.trimStart().split('\n', 2)[1] ?? '';
+  const n3 = Number(header.trim().split(/\s+/)[2]);
+
+  if (!Number.isInteger(n3) || n3 < 0) {
+    throw new Error('Could not read the output count from the circuit');
+  }
+
+  return n3;
+}
@@ -1,90 +1,547 @@
-import { EventEmitter } from "ee-typed";
-import type { IO } from "./types";
+import type { IO, PreparedMPC } from "./types";
 import workerCode from "./workerCode.js";
-import nodeSecureMPC from "./nodeSecureMPC.js";
+import nodeSecureMPC, {
+  nodeLoadCircuit,
+  nodePrepareSecureMPC,
+  releaseWarmModules as releaseNodeModules,
+} from "./nodeSecureMPC.js";
+import shouldUseMemory64 from "./memory64.js";
+import shouldUseThreads, { shouldUseAtomics } from "./threads.js";
+import shouldUseJspi from "./jspi.js";
+import RingBridge from "./RingBridge.js";
+import WarmPool from "./WarmPool.js";
+import { outputBitCount, packInput, unpackBits } from "./packedBits.js";
+import {
+  circuitDigest, circuitText, type LoadedCircuit,
+} from "./loadCircuit.js";
 
 export type SecureMPC = typeof secureMPC;
 
-const getWorkerUrl = (() => {
-  let url: string | undefined;
+function memoWorkerUrl(loadCode: () => Promise<string>) {
+  let url: Promise<string> | undefined;
 
   return () => {
-    if (!url) {
-      const blob = new Blob([workerCode], { type: 'application/javascript' });
-      url = URL.createObjectURL(blob);
-    }
+    url ??= loadCode().then(code => {
+      const blob = new Blob([code], { type: 'application/javascript' });
+      return URL.createObjectURL(blob);
+    });
 
     return url;
+  };
+}
+
+const getWorkerUrl = memoWorkerUrl(async () => workerCode);
+
+// Only loaded when needed, so bundlers can keep the wasm64 build in its own
+// chunk.
+const getWorkerUrl64 = memoWorkerUrl(
+  async () => (await import('./workerCode64.js')).default,
+);
+
+const getWorkerUrlMt = memoWorkerUrl(
+  async () => (await import('./workerCodeMt.js')).default,
+);
+
+const getWorkerUrlJspi = memoWorkerUrl(
+  async () => (await import('./workerCodeJspi.js')).default,
+);
+
+const getWorkerUrlAtomics = memoWorkerUrl(
+  async () => (await import('./workerCodeAtomics.js')).default,
+);
+
+// Idle workers by worker URL. Each keeps its instantiated module, so a
+// later computation skips decoding and compiling the wasm.
+const warmWorkers = new WarmPool<Worker>(4, worker => worker.terminate());
+
+// The loadCircuit ids each worker holds the text of, least recently used
+// first, as the worker's own list in appendWorker.ts
+const workerCircuits = new WeakMap<Worker, Set<string>>();
+const maxWorkerCircuits = 4;
+
+/**
+ * Drops the idle workers (browsers) or modules (NodeJS) kept for later
+ * computations, freeing their wasm memory.
+ */
+export function releaseWarmModules(): void {
+  warmWorkers.clear();
+  releaseNodeModules();
+}
+
+/**
+ * Hashes a circuit and parses it into warm workers (browsers) or modules
+ * (NodeJS), so computations that run it skip copying the text into wasm
+ * memory and parsing it. Pass the result as the circuit of secureMPC and
+ * prepareSecureMPC. Later computations also send a worker that has the
+ * circuit only its id. Each worker or module keeps the last few circuits
+ * it loaded or ran. size, mode, memory64, threads, jspi and atomics pick
+ * the build to load it into, as they do for secureMPC.
+ *
+ * @param instances - How many warm instances of that build to load it into,
+ *   usually the number of parties running in this process or page. 0 only
+ *   hashes the circuit, and the first computation on each instance loads it.
+ */
+export async function loadCircuit(circuit: string, {
+  size = 2, mode = 'auto', memory64, threads, jspi, atomics, instances = 1,
+}: {
+  size?: number,
+  mode?: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  memory64?: boolean,
+  threads?: boolean,
+  jspi?: boolean,
+  atomics?: boolean,
+  instances?: number,
+} = {}): Promise<LoadedCircuit> {
+  const id = await circuitDigest(circuit);
+
+  if (instances > 0) {
+    if (typeof Worker === 'undefined') {
+      await nodeLoadCircuit({
+        circuit, circuitId: id, size, mode, memory64, threads, jspi, instances,
+      });
+    } else {
+      const url = await pickWorkerUrl({
+        circuit, size, mode, memory64, threads, jspi, atomics,
+      });
+
+      await loadWorkers(url, circuit, id, instances);
+    }
   }
-})();
 
-export default function secureMPC({
-  party, size, circuit, inputBits, inputBitsPerParty, io, mode = 'auto',
+  return { id, circuit };
+}
+
+// Parses a circuit into `instances` warm workers of the build at url
+async function loadWorkers(
+  url: string,
+  circuit: string,
+  circuitId: string,
+  instances: number,
+): Promise<void> {
+  // All taken before any goes back, so each is a different worker
+  const workers: Worker[] = [];
+
+  for (let i = 0; i < instances; i++) {
+    workers.push(warmWorkers.take(url) ?? new Worker(url, { type: 'module' }));
+  }
+
+  const results = await Promise.allSettled(workers.map(worker => {
+    return new Promise<void>((resolve, reject) => {
+      worker.onmessage = event => {
+        if (event.data.type === 'loaded') {
+          resolve();
+        } else if (event.data.type === 'error') {
+          reject(new Error(event.data.error));
+        }
+      };
+
+      worker.onerror = event => reject(new Error(event.message));
+
+      worker.postMessage({
+        type: 'load',
+        ...circuitFields(worker, circuit, circuitId),
+      });
+    });
+  }));
+
+  workers.forEach((worker, i) => {
+    worker.onmessage = null;
+    worker.onerror = null;
+
+    if (results[i].status === 'fulfilled') {
+      warmWorkers.put(url, worker);
+    } else {
+      worker.terminate();
+    }
+  });
+
+  for (const result of results) {
+    if (result.status === 'rejected') {
+      throw result.reason;
+    }
+  }
+}
+
+/**
+ * The circuit of a start, prepare or load message. A loaded circuit's text
+ * is left out if the worker already has it, so large circuits aren't copied
+ * to warm workers again.
+ */
+function circuitFields(worker: Worker, circuit: string, circuitId?: string): {
+  circuit?: string,
+  circuitId?: string,
+} {
+  if (circuitId === undefined) {
+    return { circuit };
+  }
+
+  let ids = workerCircuits.get(worker);
+
+  if (!ids) {
+    ids = new Set();
+    workerCircuits.set(worker, ids);
+  }
+
+  const known = ids.delete(circuitId);
+  ids.add(circuitId);
+
+  if (ids.size > maxWorkerCircuits) {
+    ids.delete(ids.values().next().value!);
+  }
+
+  return known ? { circuitId } : { circuit, circuitId };
+}
+
+/**
+ * Runs a secure multi-party computation, see nodeSecureMPC for the
+ * parameters.
+ *
+ * @param circuit - The circuit text, or a LoadedCircuit from loadCircuit so
+ *   warm modules can reuse their parsed copy of it.
+ * @param atomics - In browsers, use the build whose worker shares its
+ *   channels with the page through rings in SharedArrayBuffer memory and
+ *   blocks in recv with Atomics.wait. Needs a cross-origin isolated page.
+ *   Off unless true, and not used with memory64, threads or jspi.
+ * @param packed - inputBits is packed 8 bits to a byte (see packBits) and
+ *   the output is returned the same way, instead of one bit per byte. Saves
+ *   packing and unpacking for large inputs and outputs.
+ */
+export default async function secureMPC({
+  party, size, circuit, inputBits, inputBitsPerParty, io, mode = 'auto', otK,
+  memory64, threads, jspi, atomics, packed = false,
 }: {
   party: number,
   size: number,
-  circuit: string,
+  circuit: string | LoadedCircuit,
   inputBits: Uint8Array,
   inputBitsPerParty: number[],
   io: IO,
-  mode?: '2pc' | 'mpc' | 'auto',
+  mode?: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  otK?: number | number[],
+  memory64?: boolean,
+  threads?: boolean,
+  jspi?: boolean,
+  atomics?: boolean,
+  packed?: boolean,
+}): Promise<Uint8Array> {
+  const text = circuitText(circuit);
+
+  const output = await runSecureMPC({
+    party, size, ...text, inputBitsPerParty, io, mode, otK,
+    memory64, threads, jspi, atomics,
+    inputBits: packInput(inputBits, inputBitsPerParty[party], packed),
+  });
+
+  return packed ? output : unpackBits(output, outputBitCount(text.circuit));
+}
+
+async function runSecureMPC({
+  party, size, circuit, circuitId, inputBits, inputBitsPerParty, io, mode, otK,
+  memory64, threads, jspi, atomics,
+}: Parameters<typeof nodeSecureMPC>[0] & {
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  atomics?: boolean,
 }): Promise<Uint8Array> {
   if (typeof Worker === 'undefined') {
     return nodeSecureMPC({
-      party, size, circuit, inputBits, inputBitsPerParty, io, mode,
+      party, size, circuit, circuitId, inputBits, inputBitsPerParty, io, mode, otK,
+      memory64, threads, jspi,
     });
   }
 
-  const ev = new EventEmitter<{ cleanup(): void }>();
-
-  const result = new Promise<Uint8Array>((resolve, reject) => {
-    const worker = new Worker(getWorkerUrl(), { type: 'module' });
-    ev.on('cleanup', () => worker.terminate());
-
-    io.on?.('error', reject);
-    ev.on('cleanup', () => io.off?.('error', reject));
+  const url = await pickWorkerUrl({
+    circuit, size, mode, memory64, threads, jspi, atomics,
+  });
+  const session = new WorkerSession(url, io);
 
-    worker.postMessage({
+  try {
+    return await session.request({
       type: 'start',
       party,
       size,
-      circuit,
+      ...session.circuitFields(circuit, circuitId),
       inputBits,
       inputBitsPerParty,
       mode,
+      otK,
+    }, 'result');
+  } finally {
+    session.close();
+  }
+}
+
+/**
+ * Runs everything in a computation that doesn't depend on the inputs, such
+ * as OT extension, preprocessing and (in 2pc mode) garbling, so it can
+ * happen while the user is still deciding on their input. The returned
+ * handle's online call then only runs the input-dependent phase. All parties
+ * must use prepareSecureMPC for the computation.
+ *
+ * Takes the same parameters as secureMPC apart from inputBits, and packed
+ * applies to the online call. In 2pc mode the garbled circuit is held until
+ * online, where secureMPC streams it, so preparing needs more memory for
+ * large circuits.
+ *
+ * @returns A promise resolving with the prepared computation once every
+ *   party has finished preparing.
+ */
+export async function prepareSecureMPC({
+  party, size, circuit, inputBitsPerParty, io, mode = 'auto', otK,
+  memory64, threads, jspi, atomics, packed = false,
+}: {
+  party: number,
+  size: number,
+  circuit: string | LoadedCircuit,
+  inputBitsPerParty: number[],
+  io: IO,
+  mode?: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  otK?: number | number[],
+  memory64?: boolean,
+  threads?: boolean,
+  jspi?: boolean,
+  atomics?: boolean,
+  packed?: boolean,
+}): Promise<PreparedMPC> {
+  const text = circuitText(circuit);
+
+  const prepared = await runPrepareSecureMPC({
+    party, size, ...text, inputBitsPerParty, io, mode, otK,
+    memory64, threads, jspi, atomics,
+  });
+
+  return {
+    online: async (inputBits: Uint8Array) => {
+      const output = await prepared.online(
+        packInput(inputBits, inputBitsPerParty[party], packed),
+      );
+
+      return packed ? output : unpackBits(output, outputBitCount(text.circuit));
+    },
+    abort: prepared.abort,
+  };
+}
+
+async function runPrepareSecureMPC({
+  party, size, circuit, circuitId, inputBitsPerParty, io, mode, otK,
+  memory64, threads, jspi, atomics,
+}: Parameters<typeof nodePrepareSecureMPC>[0] & {
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  atomics?: boolean,
+}): Promise<PreparedMPC> {
+  if (typeof Worker === 'undefined') {
+    return nodePrepareSecureMPC({
+      party, size, circuit, circuitId, inputBitsPerParty, io, mode, otK,
+      memory64, threads, jspi,
     });
+  }
 
-    worker.onmessage = async (event) => {
-      const message = event.data;
-
-      if (message.type === 'io_send') {
-        // Forward the send request to the main thread's io.send
-        const { toParty, channel, data } = message;
-        io.send(toParty, channel, data);
-      } else if (message.type === 'io_recv') {
-        const { fromParty, channel, len } = message;
-        // Handle the recv request from the worker
-        try {
-          const data = await io.recv(fromParty, channel, len);
-          worker.postMessage({ type: 'io_recv_response', id: message.id, data });
-        } catch (error) {
-          worker.postMessage({
-            type: 'io_recv_error',
-            id: message.id,
-            error: (error as Error).message,
-          });
-        }
-      } else if (message.type === 'result') {
-        // Resolve the promise with the result from the worker
-        resolve(message.result);
-      } else if (message.type === 'error') {
-        // Reject the promise if an error occurred
-        reject(new Error(message.error));
+  const url = await pickWorkerUrl({
+    circuit, size, mode, memory64, threads, jspi, atomics,
+  });
+  const session = new WorkerSession(url, io);
+
+  try {
+    await session.request({
+      type: 'prepare',
+      party,
+      size,
+      ...session.circuitFields(circuit, circuitId),
+      inputBitsPerParty,
+      mode,
+      otK,
+    }, 'prepared');
+  } catch (error) {
+    session.close();
+    throw error;
+  }
+
+  let used = false;
+
+  return {
+    online: async (inputBits: Uint8Array) => {
+      if (used) {
+        throw new Error('online can only be called once');
       }
-    };
 
-    worker.onerror = reject;
-  });
+      used = true;
+
+      try {
+        return await session.request({ type: 'online', inputBits }, 'result');
+      } finally {
+        session.close();
+      }
+    },
+    abort: () => {
+      if (!used) {
+        used = true;
+        session.close();
+      }
+    },
+  };
+}
+
+function pickWorkerUrl({ circuit, size, mode, memory64, threads, jspi, atomics }: {
+  circuit: string,
+  size: number,
+  mode: '2pc' | 'mpc' | 'auto' | 'semi-honest',
+  memory64?: boolean,
+  threads?: boolean,
+  jspi?: boolean,
+  atomics?: boolean,
+}): Promise<string> {
+  const useMemory64 = shouldUseMemory64(memory64, circuit, size, mode);
+
+  if (useMemory64) {
+    return getWorkerUrl64();
+  }
+
+  if (shouldUseThreads(threads, useMemory64)) {
+    return getWorkerUrlMt();
+  }
+
+  if (shouldUseJspi(jspi)) {
+    return getWorkerUrlJspi();
+  }
+
+  if (shouldUseAtomics(atomics)) {
+    // SharedArrayBuffer lets the worker share its channels with this
+    // thread and block in recv instead of unwinding with ASYNCIFY.
+    return getWorkerUrlAtomics();
+  }
+
+  return getWorkerUrl();
+}
 
-  return result.finally(() => ev.emit('cleanup'));
+/**
+ * A worker running one computation, with this thread bridging its io. The
+ * worker goes back to the warm pool on close if its session wound down
+ * cleanly.
+ */
+class WorkerSession {
+  private worker: Worker;
+
+  // The atomics builds open shared memory rings for their channels instead
+  // of posting io_send and io_recv
+  private rings: RingBridge;
+
+  private pending?: {
+    replyType: string,
+    resolve: (value: any) => void,
+    reject: (error: Error) => void,
+  };
+
+  // An error that arrived while no request was pending, for the next one
+  private failure?: Error;
+
+  // Set by the worker when its session wound down cleanly
+  private reusable = false;
+
+  private closed = false;
+
+  constructor(private url: string, private io: IO) {
+    this.worker = warmWorkers.take(url) ?? new Worker(url, { type: 'module' });
+    this.rings = new RingBridge(io);
+
+    io.on?.('error', this.fail);
+    this.worker.onmessage = event => this.handleMessage(event.data);
+    this.worker.onerror = event => this.fail(new Error(event.message));
+  }
+
+  /**
+   * Posts a message to the worker and resolves with the payload of its
+   * reply of replyType.
+   */
+  request(message: { type: string }, replyType: 'prepared' | 'result'): Promise<any> {
+    if (this.failure) {
+      return Promise.reject(this.failure);
+    }
+
+    return new Promise((resolve, reject) => {
+      this.pending = { replyType, resolve, reject };
+      this.worker.postMessage(message);
+    });
+  }
+
+  // circuitFields for this session's worker
+  circuitFields(circuit: string, circuitId?: string): {
+    circuit?: string,
+    circuitId?: string,
+  } {
+    return circuitFields(this.worker, circuit, circuitId);
+  }
+
+  close(): void {
+    if (this.closed) {
+      return;
+    }
+
+    this.closed = true;
+    this.io.off?.('error', this.fail);
+
+    if (this.reusable && !this.failure) {
+      this.worker.onmessage = null;
+      this.worker.onerror = null;
+      warmWorkers.put(this.url, this.worker);
+    } else {
+      this.worker.terminate();
+    }
+  }
+
+  private fail = (error: Error) => {
+    this.failure ??= error;
+    this.reusable = false;
+
+    const pending = this.pending;
+    this.pending = undefined;
+    pending?.reject(error);
+  };
+
+  private async handleMessage(message: any) {
+    const { worker, io } = this;
+
+    if (message.type === 'io_send') {
+      // Forward the send request to the main thread's io.send
+      const { toParty, channel, data } = message;
+      io.send(toParty, channel, data);
+    } else if (message.type === 'io_recv') {
+      // maxLen is set when the worker reads ahead, then any amount from
+      // len up to it will do
+      const { fromParty, channel, len, maxLen = len } = message;
+      // Handle the recv request from the worker
+      try {
+        const data = io.recvAvailable
+          ? await io.recvAvailable(fromParty, channel, len, maxLen)
+          : await io.recv(fromParty, channel, len);
+
+        worker.postMessage({ type: 'io_recv_response', id: message.id, data });
+      } catch (error) {
+        worker.postMessage({
+          type: 'io_recv_error',
+          id: message.id,
+          error: (error as Error).message,
+        });
+      }
+    } else if (message.type === 'io_ring_open') {
+      const { otherParty, channel, outPtr, inPtr, memory } = message;
+      this.rings.open(otherParty, channel, outPtr, inPtr, memory);
+    } else if (message.type === 'io_ring') {
+      // A failed recv also fails the worker's wait, but the io's own
+      // error says more
+      this.rings.doorbell(message.ptr).catch(this.fail);
+    } else if (message.type === 'prepared' || message.type === 'result') {
+      if (message.type === 'result') {
+        this.reusable = message.reusable === true;
+      }
+
+      const pending = this.pending;
+
+      if (pending?.replyType === message.type) {
+        this.pending = undefined;
+        pending.resolve(message.result);
+      }
+    } else if (message.type === 'error') {
+      // Reject the pending request if an error occurred
+      this.fail(new Error(message.error));
+    }
+  }
 }
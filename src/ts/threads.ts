@@ -0,0 +1,81 @@
+/**
+ * Decides whether to load the multithreaded (wasm pthreads) build.
+ *
+ * @param threads - true or false to force a build, undefined to use threads
+ *   on cross-origin isolated pages with more than one core. NodeJS has
+ *   SharedArrayBuffer but isn't cross-origin isolated, so it needs true.
+ * @param memory64 - whether the memory64 build was already picked, there is
+ *   no multithreaded memory64 build.
+ * @returns true if the multithreaded build should be used.
+ */
+export default function shouldUseThreads(
+  threads: boolean | undefined,
+  memory64: boolean,
+): boolean {
+  if (threads === false) {
+    return false;
+  }
+
+  if (threads === true) {
+    if (memory64) {
+      throw new Error('threads and memory64 can not be combined');
+    }
+
+    if (!supportsThreads()) {
+      throw new Error(
+        'threads requested but SharedArrayBuffer is not available here ' +
+        '(browsers need the page to be cross-origin isolated)',
+      );
+    }
+
+    return true;
+  }
+
+  // Only where crossOriginIsolated is actually true, not merely undefined as
+  // in NodeJS, where the jslib-mt build hasn't been through the test suite
+  return (
+    !memory64 &&
+    supportsThreads() &&
+    (globalThis as { crossOriginIsolated?: boolean }).crossOriginIsolated === true &&
+    hardwareConcurrency() > 1
+  );
+}
+
+/**
+ * Decides whether a single-threaded browser worker loads the atomics build,
+ * whose channels are rings in shared wasm memory (RingBridge.ts).
+ *
+ * @param atomics - true to use it, anything else keeps the ASYNCIFY build.
+ *   It isn't picked by default until it has passed npm test and
+ *   npm run bench:builds.
+ * @returns true if the atomics build should be used.
+ */
+export function shouldUseAtomics(atomics: boolean | undefined): boolean {
+  if (atomics !== true) {
+    return false;
+  }
+
+  if (!supportsThreads()) {
+    throw new Error(
+      'atomics requested but SharedArrayBuffer is not available here ' +
+      '(browsers need the page to be cross-origin isolated)',
+    );
+  }
+
+  return true;
+}
+
+/**
+ * Detects what wasm pthreads need: SharedArrayBuffer, which browsers only
+ * expose to cross-origin isolated pages.
+ */
+export function supportsThreads(): boolean {
+  return (
+    typeof SharedArrayBuffer !== 'undefined' &&
+    (globalThis as { crossOriginIsolated?: boolean }).crossOriginIsolated !== false
+  );
+}
+
+function hardwareConcurrency(): number {
+  return globalThis.navigator?.hardwareConcurrency ?? 1;
+}
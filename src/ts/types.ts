@@ -1,7 +1,44 @@
 export type IO = {
   send: (toParty: number, channel: 'a' | 'b', data: Uint8Array) => void;
   recv: (fromParty: number, channel: 'a' | 'b', len: number) => Promise<Uint8Array>;
+
+  /**
+   * Optional: resolves with at least minLen and at most maxLen bytes, taking
+   * whatever has already arrived. The wasm side reads ahead with it, so many
+   * small receives cost one call instead of one each.
+   *
+   * Bytes read ahead are dropped when the computation ends, so an io that
+   * implements this mustn't carry a later computation's data, or that one
+   * will wait for bytes that never come. Use a fresh io (or a fresh
+   * connection) per computation.
+   */
+  recvAvailable?: (
+    fromParty: number,
+    channel: 'a' | 'b',
+    minLen: number,
+    maxLen: number,
+  ) => Promise<Uint8Array>;
+
   on?: (event: 'error', listener: (error: Error) => void) => void;
   off?: (event: 'error', listener: (error: Error) => void) => void;
   close?: () => void;
 };
+
+/**
+ * A computation that has run everything that doesn't depend on the inputs,
+ * from prepareSecureMPC.
+ */
+export type PreparedMPC = {
+  /**
+   * Runs the rest of the computation with this party's input bits, one bit
+   * per byte, or packed 8 to a byte if prepared with packed. Can only be
+   * called once.
+   */
+  online: (inputBits: Uint8Array) => Promise<Uint8Array>;
+
+  /**
+   * Discards the computation without running it. The other parties' online
+   * calls won't complete.
+   */
+  abort: () => void;
+};
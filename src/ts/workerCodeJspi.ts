@@ -0,0 +1 @@
+export default '<<WORKER_CODE_JSPI>>';
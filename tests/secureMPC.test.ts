@@ -1,7 +1,44 @@
 import { expect } from 'chai';
-import { BufferQueue, secureMPC } from "../src/ts"
+import {
+  BufferQueue, loadCircuit, packBits, prepareSecureMPC, releaseWarmModules,
+  secureMPC, unpackBits,
+} from "../src/ts"
+import { supportsMemory64 } from "../src/ts/memory64"
+import { supportsThreads } from "../src/ts/threads"
+import { supportsJspi } from "../src/ts/jspi"
+
+describe('BufferQueue', () => {
+  it('popAvailable takes what has arrived, up to maxLen', async () => {
+    const bq = new BufferQueue();
+
+    const pending = bq.popAvailable(2, 4);
+    bq.push(new Uint8Array([1]));
+    bq.push(new Uint8Array([2, 3]));
+    expect(await pending).to.deep.equal(new Uint8Array([1, 2, 3]));
+
+    bq.push(new Uint8Array([4, 5, 6, 7, 8]));
+    expect(await bq.popAvailable(1, 4)).to.deep.equal(new Uint8Array([4, 5, 6, 7]));
+    expect(await bq.pop(1)).to.deep.equal(new Uint8Array([8]));
+  });
+});
+
+describe('packBits', () => {
+  it('packs little-endian and unpacks back', () => {
+    const bits = Uint8Array.from([1, 0, 0, 0, 0, 0, 0, 0, 1, 1]);
+    const packed = packBits(bits);
+
+    expect(packed).to.deep.equal(Uint8Array.from([1, 3]));
+    expect(unpackBits(packed, 10)).to.deep.equal(bits);
+  });
+});
 
 describe('Secure MPC', () => {
+  // The threads tests leave warm modules whose threads would keep mocha
+  // running
+  after(() => {
+    releaseWarmModules();
+  });
+
   it('3 + 5 == 8 (2pc)', async function () {
     // Note: This tends to run a bit slower than mpc mode, but that's because
     // of the cold start. Running mpc first is slower than running 2pc first.
@@ -20,6 +57,137 @@ describe('Secure MPC', () => {
     this.timeout(20_000);
     expect(await internalDemoN(3, 5, 5)).to.deep.equal([8, 8, 8, 8, 8]);
   });
+
+  it('3 + 5 == 8 (3 parties, SoftSpokenOT)', async function () {
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 3, { otK: 4 })).to.deep.equal([8, 8, 8]);
+  });
+
+  it('3 + 5 == 8 (3 parties, memory64)', async function () {
+    if (!supportsMemory64()) {
+      // NodeJS before v24 needs `npm run test:memory64`
+      this.skip();
+    }
+
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 3, { memory64: true })).to.deep.equal([8, 8, 8]);
+  });
+
+  it('3 + 5 == 8 (2pc, baseline build)', async function () {
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 2, { mode: '2pc', memory64: false, threads: false, jspi: false })).to.deep.equal([8, 8]);
+  });
+
+  it('3 + 5 == 8 (3 parties, baseline build)', async function () {
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 3, { memory64: false, threads: false, jspi: false })).to.deep.equal([8, 8, 8]);
+  });
+
+  it('3 + 5 == 8 (2pc, threads)', async function () {
+    if (!supportsThreads()) {
+      this.skip();
+    }
+
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 2, { mode: '2pc', threads: true })).to.deep.equal([8, 8]);
+  });
+
+  it('3 + 5 == 8 (3 parties, threads)', async function () {
+    if (!supportsThreads()) {
+      this.skip();
+    }
+
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 3, { threads: true })).to.deep.equal([8, 8, 8]);
+  });
+
+  it('3 + 5 == 8 (2pc, jspi)', async function () {
+    if (!supportsJspi()) {
+      this.skip();
+    }
+
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 2, { mode: '2pc', threads: false, jspi: true })).to.deep.equal([8, 8]);
+  });
+
+  it('3 + 5 == 8 (3 parties, jspi)', async function () {
+    if (!supportsJspi()) {
+      this.skip();
+    }
+
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 3, { threads: false, jspi: true })).to.deep.equal([8, 8, 8]);
+  });
+
+  it('3 + 5 == 8 (2pc, packed)', async function () {
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 2, { mode: '2pc', packed: true })).to.deep.equal([8, 8]);
+  });
+
+  it('3 + 5 == 8 (3 parties, packed)', async function () {
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 3, { packed: true })).to.deep.equal([8, 8, 8]);
+  });
+
+  it('3 + 5 == 8 (2pc, prepared before the inputs)', async function () {
+    this.timeout(20_000);
+    expect(await preparedDemoN(3, 5, 2, { mode: '2pc' })).to.deep.equal([8, 8]);
+  });
+
+  it('3 + 5 == 8 (3 parties, prepared before the inputs)', async function () {
+    this.timeout(20_000);
+    expect(await preparedDemoN(3, 5, 3)).to.deep.equal([8, 8, 8]);
+  });
+
+  it('3 + 5 == 8 (semi-honest)', async function () {
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 2, { mode: 'semi-honest' })).to.deep.equal([8, 8]);
+  });
+
+  it('3 + 5 == 8 (semi-honest, prepared before the inputs)', async function () {
+    this.timeout(20_000);
+    expect(await preparedDemoN(3, 5, 2, { mode: 'semi-honest' })).to.deep.equal([8, 8]);
+  });
+
+  it('3 + 5 == 8 (3 parties, semi-honest)', async function () {
+    this.timeout(20_000);
+    expect(await internalDemoN(3, 5, 3, { mode: 'semi-honest' })).to.deep.equal([8, 8, 8]);
+  });
+
+  it('3 + 5 == 8 (3 parties, semi-honest, prepared before the inputs)', async function () {
+    this.timeout(20_000);
+    expect(await preparedDemoN(3, 5, 3, { mode: 'semi-honest' })).to.deep.equal([8, 8, 8]);
+  });
+
+  it('runs sessions back to back on warm modules', async function () {
+    this.timeout(20_000);
+    releaseWarmModules();
+
+    expect(await internalDemo(3, 5, '2pc')).to.deep.equal({ alice: 8, bob: 8 });
+    expect(await internalDemo(1, 2, '2pc')).to.deep.equal({ alice: 3, bob: 3 });
+    expect(await internalDemoN(4, 6, 3)).to.deep.equal([10, 10, 10]);
+    expect(await internalDemo(7, 9, 'mpc')).to.deep.equal({ alice: 16, bob: 16 });
+  });
+
+  it('reuses a loaded circuit on warm modules', async function () {
+    this.timeout(20_000);
+    const circuit = await loadCircuit(add32BitCircuit);
+
+    expect(circuit.id).to.equal((await loadCircuit(add32BitCircuit)).id);
+    expect(await internalDemoN(3, 5, 2, { circuit })).to.deep.equal([8, 8]);
+    expect(await internalDemoN(4, 6, 2, { circuit })).to.deep.equal([10, 10]);
+    expect(await internalDemoN(1, 2, 3, { circuit })).to.deep.equal([3, 3, 3]);
+  });
+
+  it('runs a circuit preloaded into warm modules', async function () {
+    this.timeout(20_000);
+    releaseWarmModules();
+
+    const circuit = await loadCircuit(add32BitCircuit, { size: 3, instances: 3 });
+
+    expect(await internalDemoN(3, 5, 3, { circuit })).to.deep.equal([8, 8, 8]);
+    expect(await loadCircuit(add32BitCircuit, { instances: 0 })).to.deep.equal(circuit);
+  });
 });
 
 class BufferQueueStore {
@@ -91,7 +259,8 @@ async function internalDemo(
 async function internalDemoN(
   p0Input: number,
   p1Input: number,
-  size: number
+  size: number,
+  options: Partial<Parameters<typeof secureMPC>[0]> = {},
 ): Promise<number[]> {
   const bqs = new BufferQueueStore();
 
@@ -99,17 +268,20 @@ async function internalDemoN(
   inputBitsPerParty[0] = 32;
   inputBitsPerParty[1] = 32;
 
+  // With packed, inputs and outputs are converted here instead
+  const pack = options.packed ? packBits : (bits: Uint8Array) => bits;
+
   const outputBits = await Promise.all(new Array(size).fill(0).map((_0, party) => secureMPC({
     party,
     size,
     circuit: add32BitCircuit,
     inputBits: (() => {
       if (party === 0) {
-        return numberTo32Bits(p0Input);
+        return pack(numberTo32Bits(p0Input));
       }
 
       if (party === 1) {
-        return numberTo32Bits(p1Input);
+        return pack(numberTo32Bits(p1Input));
       }
 
       return new Uint8Array(0);
@@ -122,9 +294,52 @@ async function internalDemoN(
       recv: async (fromParty, channel, len) => {
         return bqs.get(fromParty, party, channel).pop(len);
       },
-    }
+      recvAvailable: async (fromParty, channel, minLen, maxLen) => {
+        return bqs.get(fromParty, party, channel).popAvailable(minLen, maxLen);
+      },
+    },
+    ...options,
+  })));
+
+  return outputBits.map(bits => {
+    return numberFrom32Bits(options.packed ? unpackBits(bits, 33) : bits);
+  });
+}
+
+async function preparedDemoN(
+  p0Input: number,
+  p1Input: number,
+  size: number,
+  options: Partial<Parameters<typeof prepareSecureMPC>[0]> = {},
+): Promise<number[]> {
+  const bqs = new BufferQueueStore();
+
+  const inputBitsPerParty = new Array(size).fill(0);
+  inputBitsPerParty[0] = 32;
+  inputBitsPerParty[1] = 32;
+
+  const prepared = await Promise.all(new Array(size).fill(0).map((_0, party) => prepareSecureMPC({
+    party,
+    size,
+    circuit: add32BitCircuit,
+    inputBitsPerParty,
+    io: {
+      send: (toParty, channel, data) => {
+        bqs.get(party, toParty, channel).push(data);
+      },
+      recv: async (fromParty, channel, len) => {
+        return bqs.get(fromParty, party, channel).pop(len);
+      },
+    },
+    ...options,
   })));
 
+  const inputs = [numberTo32Bits(p0Input), numberTo32Bits(p1Input)];
+
+  const outputBits = await Promise.all(prepared.map((p, party) => {
+    return p.online(inputs[party] ?? new Uint8Array(0));
+  }));
+
   return outputBits.map(bits => numberFrom32Bits(bits));
 }
 